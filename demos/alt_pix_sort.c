@@ -40,14 +40,18 @@ tup3 fragment(tup3 *frag_coord)
     if (! (FRAME_COUNT % 2))
     {
         int start_y = (self_index / WINDOW_SIZE) * WINDOW_SIZE;
-        // Load in local pixel window
-        for (; n_samples < WINDOW_SIZE && ! framebuf_read(BACKBUF, (int) frag_coord->x, start_y + n_samples, samples + n_samples); n_samples++);
+        // Load in local pixel window (cut short at the bottom of the frame)
+        n_samples = (int) BACKBUF->dimy - start_y < WINDOW_SIZE ? (int) BACKBUF->dimy - start_y : WINDOW_SIZE;
+        framebuf_gather_col(BACKBUF, (int) frag_coord->x, start_y, n_samples, FB_ADDR_CLAMP, samples);
     }
     else
     {
         int start_y = (self_index / WINDOW_SIZE) * WINDOW_SIZE + (self_index % INTERLEAVE_GAP);
         // Load in interleaved pixel window
-        for (; n_samples < WINDOW_SIZE && ! framebuf_read(BACKBUF, (int) frag_coord->x, start_y + n_samples * INTERLEAVE_GAP, samples + n_samples); n_samples++);
+        for (; n_samples < WINDOW_SIZE && start_y + n_samples * INTERLEAVE_GAP < (int) BACKBUF->dimy; n_samples++)
+        {
+            samples[n_samples] = framebuf_get(BACKBUF, (unsigned int) frag_coord->x, start_y + n_samples * INTERLEAVE_GAP);
+        }
     }
 
     // Sort pixel window
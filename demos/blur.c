@@ -0,0 +1,32 @@
+#define BLUR_RADIUS (2)
+#define BLUR_DIM (2 * BLUR_RADIUS + 1)
+
+/* Stage each job's neighbourhood of BACKBUF, as every pixel reads the pixels around it */
+void frame_setup()
+{
+    stage_backbuf = 1;
+    stage_halo = BLUR_RADIUS;
+    stage_address = FB_ADDR_MIRROR;
+}
+
+/* Box blur, diffusing the previous frame further each frame */
+tup3 fragment(tup3 *frag_coord)
+{
+    int x = (int) frag_coord->x;
+    int y = (int) frag_coord->y;
+    tup3 sum = col_xyz(0.0, 0.0, 0.0);
+
+    for (int dy = -BLUR_RADIUS; dy <= BLUR_RADIUS; dy++)
+    {
+        for (int dx = -BLUR_RADIUS; dx <= BLUR_RADIUS; dx++)
+        {
+            tup3 sample = staged_get(x + dx, y + dy);
+
+            sum.x += sample.x;
+            sum.y += sample.y;
+            sum.z += sample.z;
+        }
+    }
+
+    return col_xyz(sum.x / (BLUR_DIM * BLUR_DIM), sum.y / (BLUR_DIM * BLUR_DIM), sum.z / (BLUR_DIM * BLUR_DIM));
+}
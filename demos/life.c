@@ -0,0 +1,54 @@
+#define LIFE_STEPS (8)
+
+/* Each generation only depends on the cells around it, so advance several per job, saving every eighth */
+void frame_setup()
+{
+    stage_backbuf = 1;
+    stage_halo = 1;
+    stage_address = FB_ADDR_CLAMP;
+    stage_frames = LIFE_STEPS;
+}
+
+/* A threshold in (0, 1) for each cell, dithering the input into a first generation (later generations are black or white) */
+static inline float cell_threshold(int x, int y)
+{
+    unsigned int h = (unsigned int) x * 374761393u + (unsigned int) y * 668265263u;
+
+    h = (h ^ (h >> 13)) * 1274126177u;
+
+    return ((h >> 8) & 0xFFFF) / 65536.0f * 0.9f + 0.05f;
+}
+
+/* Conway's Game of Life, where the cells of the first generation are dithered from the input */
+tup3 fragment(tup3 *frag_coord)
+{
+    int x = (int) frag_coord->x;
+    int y = (int) frag_coord->y;
+    int neighbours = 0;
+    int alive = 0;
+
+    for (int dy = -1; dy <= 1; dy++)
+    {
+        for (int dx = -1; dx <= 1; dx++)
+        {
+            tup3 cell = staged_get(x + dx, y + dy);
+            int cell_alive = (cell.x + cell.y + cell.z) > 3.0f * cell_threshold(x + dx, y + dy);
+
+            if (dx == 0 && dy == 0)
+            {
+                alive = cell_alive;
+            }
+            else
+            {
+                neighbours += cell_alive;
+            }
+        }
+    }
+
+    if (neighbours == 3 || (alive && neighbours == 2))
+    {
+        return col_xyz(1.0, 1.0, 1.0);
+    }
+
+    return col_xyz(0.0, 0.0, 0.0);
+}
@@ -1,9 +1,15 @@
+tup3 rand_v;
+
+void frame_setup()
+{
+    rand_v = vec3(12.9898, 78.233, 0.0);
+    rand_v = mul_t3(&rand_v, FRAME_COUNT + 1);
+}
+
 float frag_rand(tup3 *st)
 {
-    tup3 v = vec3(12.9898, 78.233, 0.0);
-    v = mul_t3(&v, FRAME_COUNT + 1);
     float iptr;
-    return modff(sinf(dot_t3(st, &v)), &iptr) * 43758.543123;
+    return modff(sinf(dot_t3(st, &rand_v)), &iptr) * 43758.543123;
 }
 
 tup3 fragment(tup3 *frag_coord)
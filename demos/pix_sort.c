@@ -27,23 +27,30 @@ int cmp_t3(const void *a, const void *b)
 #define MAX_WINDOW_SIZE (128)
 #define WINDOW_GROWTH (3)
 
-/* Widening window sort */
-tup3 fragment(tup3 *frag_coord)
+/* Each window is a column segment, which widens each frame */
+void frame_setup()
 {
-    tup3 samples[MAX_WINDOW_SIZE];
-    int n_samples = 0;
     int window_size = 3 * (FRAME_COUNT + 1);
 
-    window_size = window_size > MAX_WINDOW_SIZE ? MAX_WINDOW_SIZE : window_size;
+    group_w = 1;
+    group_h = window_size > MAX_WINDOW_SIZE ? MAX_WINDOW_SIZE : window_size;
+}
+
+/* Widening window sort - each window is sorted once, then written out whole */
+void group_fragment(unsigned int x, unsigned int y, unsigned int w, unsigned int h, framebuf *out)
+{
+    tup3 samples[MAX_WINDOW_SIZE];
 
-    int self_index = (int) frag_coord->y;
-    int start_y = (self_index / window_size) * window_size;
+    (void) w;
 
-    // Load in pixel window
-    for (; n_samples < window_size && ! framebuf_read(BACKBUF, (int) frag_coord->x, start_y + n_samples, samples + n_samples); n_samples++);
+    // Load in pixel window (groups always lie within the frame)
+    framebuf_gather_col(BACKBUF, x, y, h, FB_ADDR_CLAMP, samples);
 
     // Sort pixel window
-    qsort(samples, n_samples, sizeof(tup3), cmp_t3);
+    qsort(samples, h, sizeof(tup3), cmp_t3);
 
-    return samples[(self_index % window_size)];
+    for (unsigned int i = 0; i < h; i++)
+    {
+        framebuf_set(out, x, y + i, samples + i);
+    }
 }
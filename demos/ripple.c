@@ -0,0 +1,41 @@
+#define WAVE_SPEED (0.25f)
+#define WAVE_DAMPING (0.995f)
+
+/* Each frame is stepped from the two frames before it, so keep one frame besides BACKBUF */
+__attribute__((constructor)) static void keep_history(void)
+{
+    history_frames = 2;
+}
+
+/* The wave equation, where the input starts at rest and ripples out from its edges */
+tup3 fragment(tup3 *frag_coord)
+{
+    int x = (int) frag_coord->x;
+    int y = (int) frag_coord->y;
+
+    // Before the first frame, the input is its own previous frame
+    framebuf *prev = BACKBUF_N(1);
+    framebuf *prev_2 = (FRAME_COUNT > 0) ? BACKBUF_N(2) : prev;
+
+    tup3 u = framebuf_get(prev, x, y);
+    tup3 u_prev = framebuf_get(prev_2, x, y);
+    tup3 lap = col_xyz(-4.0 * u.x, -4.0 * u.y, -4.0 * u.z);
+
+    tup3 neighbours[4] = {
+        framebuf_sample_clamp(prev, x - 1, y),
+        framebuf_sample_clamp(prev, x + 1, y),
+        framebuf_sample_clamp(prev, x, y - 1),
+        framebuf_sample_clamp(prev, x, y + 1),
+    };
+
+    for (int i = 0; i < 4; i++)
+    {
+        lap.x += neighbours[i].x;
+        lap.y += neighbours[i].y;
+        lap.z += neighbours[i].z;
+    }
+
+    return col_xyz(u.x + (u.x - u_prev.x + WAVE_SPEED * lap.x) * WAVE_DAMPING,
+                   u.y + (u.y - u_prev.y + WAVE_SPEED * lap.y) * WAVE_DAMPING,
+                   u.z + (u.z - u_prev.z + WAVE_SPEED * lap.z) * WAVE_DAMPING);
+}
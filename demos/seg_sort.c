@@ -0,0 +1,18 @@
+#define MAX_SEGMENT_LEN (512)
+
+/* Each frame sorts column segments by hue, and the segments lengthen each frame */
+void frame_setup()
+{
+    unsigned int segment_len = 8 << FRAME_COUNT;
+
+    frame_sort.enabled = 1;
+    frame_sort.axis = SORT_AXIS_COLUMNS;
+    frame_sort.segment_len = segment_len > MAX_SEGMENT_LEN ? MAX_SEGMENT_LEN : segment_len;
+    frame_sort.key = pixel_hue;
+}
+
+/* Carry the previous frame over, to be sorted further */
+tup3 fragment(tup3 *frag_coord)
+{
+    return framebuf_get(BACKBUF, (unsigned int) frag_coord->x, (unsigned int) frag_coord->y);
+}
@@ -3,12 +3,26 @@
  *
  * A fragment shader shall implement;
  *  - `fragment`, a function that renders a single pixel based on its coordinates
+ *                (unless one of the alternatives below is provided instead)
  *  - `frag_init`, a function that loads any user-provided resources, and handles
  *                 arguments provided to the program
  *                 must also invoke `create_render_frame`
  *                 expected to set `n_threads`, `n_jobs`, etc. if non-default values are
  *                 desired
  *  - `frag_cleanup`, a function that shall clean up any resources created by frag_init
+ *
+ * A fragment shader may also implement;
+ *  - `fragment_span`, a function that renders a run of pixels in a row, which is preferred
+ *                     over `fragment` if defined
+ *  - `fragment_x8`, a function that renders a packet of eight adjacent pixels at once,
+ *                   which is preferred over `fragment` (but not `fragment_span`) if defined
+ *  - `fragment_render_job`, the render loop itself, instantiated from render_loop.h in the
+ *                           shader's translation unit so that `fragment` is inlined into it
+ *  - `group_fragment`, a function that renders a whole group of pixels (eg. a window that
+ *                      is computed once for all of its pixels), which is preferred over all
+ *                      of the above if defined
+ *  - `frame_setup`, a function that computes values shared by every pixel of a frame
+ *  - `row_setup`, a function that computes values shared by every pixel of a row
  */
 
 #ifndef FRAGMENT_H
@@ -21,6 +35,57 @@
 #include "framebuffer.h"
 #include "frame_io.h"
 #include "render_job.h"
+#include "tuple_x8.h"
+#include "scratch.h"
+
+
+// -----===[ Definitions ]===-----
+
+// The most pixels that `fragment_span` is given at once
+#define FRAGMENT_SPAN_MAX (256)
+
+// Storage for the results of `row_setup` - each thread has its own copy
+#define ROW_LOCAL _Thread_local
+
+// The frame rendered `k` frames before the current one (see `history_frames` and `backbuf_n`)
+#define BACKBUF_N(k) backbuf_n(k)
+
+
+// -----===[ Structures ]===-----
+
+/*
+ * A pass that sorts segments of each finished frame (see `framebuf_sort_segments`)
+ *
+ * enabled [int] - whether the pass runs
+ * axis [sort_axis] - whether rows or columns are sorted
+ * segment_len [unsigned int] - the length of each sorted segment (0 for whole rows / columns)
+ * key [pixel_key | NULL] - the key to sort pixels by (NULL for luminance)
+ */
+typedef struct sort_pass {
+    int enabled;
+    sort_axis axis;
+    unsigned int segment_len;
+    pixel_key key;
+} sort_pass;
+
+
+/*
+ * A copy of the region of BACKBUF around the current job (see `stage_backbuf`)
+ *
+ * buf [tup3 *] - the staged pixels, row by row
+ * x0 [int] - the x coordinate (in the frame) of the first staged pixel
+ * y0 [int] - the y coordinate (in the frame) of the first staged pixel
+ * w [unsigned int] - the width of the staged region
+ * h [unsigned int] - the height of the staged region
+ */
+typedef struct staged_region {
+    tup3 *buf;
+    int x0;
+    int y0;
+    unsigned int w;
+    unsigned int h;
+} staged_region;
+
 
 // -----===[ Globals ]===-----
 
@@ -32,28 +97,254 @@ extern unsigned int n_threads;
  *
  * Ideally, will always be >= n_threads, and a multiple of n_threads
  *
- * Frames are split into horizontal bands for jobs, meaning that (at most)
- * one job can be dispatched for each row (pixel in the y-axis) of the render frame
+ * Unless tiles are used (see `tile_w` and `tile_h`), frames are split into horizontal
+ * bands for jobs, meaning that (at most) one job can be dispatched for each row
+ * (pixel in the y-axis) of the render frame
  * This value provides an upper bound - very short render frames may not receive a full
  * number of jobs
  */
 extern unsigned int n_jobs;
 
 
+/*
+ * The dimensions (in pixels) of the tile rendered by each job - both default to zero
+ *
+ * If both are non-zero, frames are split into tiles (clipped at the frame edges) instead of
+ * horizontal bands, and `n_jobs` is ignored
+ * Tiles suit shaders that sample BACKBUF in neighbourhoods or columns
+ */
+extern unsigned int tile_w;
+extern unsigned int tile_h;
+
+
+/*
+ * The order in which tiles are issued - defaults to TILE_ORDER_ROW
+ *
+ * TILE_ORDER_MORTON and TILE_ORDER_HILBERT issue neighbouring tiles close together in time,
+ * so that they share cache (see render_job.h)
+ */
+extern tile_order tile_traversal;
+
+
+/*
+ * Whether jobs should adapt to the measured cost of the previous frame - defaults to zero
+ *
+ * If non-zero, the time taken by each job is recorded, and after each frame bands are
+ * re-cut to be of equal cost (rather than equal size), and jobs are issued most expensive
+ * first (except when work stealing, where each thread's run is kept contiguous)
+ * Suits multi-frame renders where the cost of each region is stable between frames
+ */
+extern int adaptive_jobs;
+
+
+/*
+ * Whether threads should be pinned to CPUs - defaults to zero
+ *
+ * If non-zero, each thread is pinned to its own CPU (cycling through the CPUs the process may
+ * run on), and the render frame and BACKBUF are re-placed so that each page is first touched by
+ * the thread that usually renders it (its run of jobs when work stealing, or an even share of
+ * rows otherwise) - keeping memory local to each NUMA node
+ */
+extern int pin_threads;
+
+
+/*
+ * The dimensions (in pixels) of each group rendered by `group_fragment` - both default to zero
+ * (treated as one)
+ *
+ * Groups tile the frame from (0, 0), and are clipped at the frame edges
+ * Jobs are aligned to whole groups (tiles are grown to a multiple of the group size, and band
+ * boundaries fall between rows of groups), so each group is rendered by one thread
+ * May be changed in `frame_setup` (eg. for a window that grows each frame), in which case jobs
+ * are re-aligned before the frame is rendered
+ */
+extern unsigned int group_w;
+extern unsigned int group_h;
+
+
+/*
+ * The size (in bytes) of each thread's scratch arena (see WORKER_SCRATCH) - defaults to 64KiB
+ *
+ * Zero disables scratch arenas
+ */
+extern size_t scratch_size;
+
+
+/*
+ * Whether the render frame and BACKBUF should trade places after each frame - defaults to zero
+ *
+ * If non-zero, BACKBUF is updated by swapping pointers rather than copying every pixel of the
+ * render frame into it, so BACKBUF may point to a different framebuf each frame
+ * Templates that keep their own pointer to BACKBUF, or rely on the render frame keeping its
+ * contents between frames, should leave this unset
+ */
+extern int swap_backbuf;
+
+
+/*
+ * The number of frames that may await output at once - defaults to zero
+ *
+ * If non-zero, finished frames are handed to `n_writers` dedicated writer threads (defaults to
+ * one) to be encoded and saved, while rendering continues into a spare framebuffer
+ * Rendering only waits for the writers once `pipeline_depth` frames are awaiting output, so
+ * at most `pipeline_depth` extra framebuffers are allocated (see frame_io.h)
+ * Suits multi-frame renders, where saving each frame is as slow as rendering it
+ */
+extern unsigned int pipeline_depth;
+extern unsigned int n_writers;
+
+
+/*
+ * Whether each job should stage its region of BACKBUF (see STAGED) before it is rendered
+ * - defaults to zero
+ *
+ * Each job's region, grown by `stage_halo` pixels on every side, is copied into a contiguous
+ * buffer of the rendering thread, so that samples of it are read from hot memory (whatever the
+ * format and layout of BACKBUF) - pixels of the halo outside of the frame are mapped back into
+ * it by `stage_address` (defaults to FB_ADDR_CLAMP)
+ * Suits stencil shaders that sample a small neighbourhood of each pixel, with small tiles (see
+ * `tile_w` and `tile_h`) so that each staged region stays in cache
+ */
+extern int stage_backbuf;
+extern unsigned int stage_halo;
+extern fb_address stage_address;
+
+
+/*
+ * The number of frames that each job advances at once, when staging BACKBUF - defaults to one
+ *
+ * If greater than one, each job stages a halo of `stage_halo` pixels for every frame, then renders
+ * its region of each frame in turn into the thread's own buffers (each frame needing a halo less
+ * than the last), so that only the last frame of each block is written to the render frame
+ * Only that frame is saved, or becomes BACKBUF - the frames between are never whole, and are not
+ * output - and `frame_setup` is called (and FRAME_COUNT and CLOCK_NS updated) once per block
+ * Suits iterative stencil shaders (eg. cellular automata or diffusion) that read BACKBUF only
+ * through `staged_get`, within `stage_halo` pixels, and do not change over time
+ * Only applies to shaders rendering with `fragment`, without a sort pass, with `stage_address`
+ * clamping or mirroring, with `backbuf_format` left as FB_FORMAT_TUP3 (the frames between are
+ * never converted), and while the block's halo fits within the frame
+ */
+extern unsigned int stage_frames;
+
+
+/*
+ * The pixel format of BACKBUF (see framebuffer.h) - defaults to FB_FORMAT_TUP3
+ *
+ * A compact format (eg. FB_FORMAT_RGBA8) cuts the memory, and the bandwidth of every BACKBUF
+ * sample, at the cost of precision - suits shaders that sample BACKBUF heavily
+ * BACKBUF is converted once `frag_init` returns, and each frame is converted into it (rather
+ * than trading places with it, see `swap_backbuf`)
+ * Must be set in `frag_init`, or before it (eg. in a constructor)
+ */
+extern fb_format backbuf_format;
+
+
+/*
+ * The memory layout of BACKBUF (see framebuffer.h) - defaults to FB_LAYOUT_LINEAR
+ *
+ * A tiled layout (eg. FB_LAYOUT_TILED) keeps pixels above and below one another close in
+ * memory - suits shaders that sample BACKBUF in columns or neighbourhoods
+ * Applied, and must be set, as for `backbuf_format`
+ */
+extern fb_layout backbuf_layout;
+
+
+/*
+ * The number of previous frames that shaders can read (through BACKBUF_N) - defaults to one
+ *
+ * BACKBUF is the first of them, and the rest are kept in a ring of framebuffers, allocated once
+ * by `create_render_frame` - so shaders that only read BACKBUF pay for no history
+ * After each frame, BACKBUF takes the place of the oldest frame of the ring, and that frame's
+ * framebuffer is reused for the next, so no frame is ever copied to keep it
+ * Suits temporal effects (eg. smoothing, trails, or integrators that step from several frames)
+ * Must be set before `create_render_frame` (eg. in a constructor) - while above one, frames are
+ * never advanced in blocks (see `stage_frames`), and JOB_SCHED_WAVEFRONT cannot be used
+ */
+extern unsigned int history_frames;
+
+
+/*
+ * A sort applied to each frame after it is rendered, and before it is saved (and becomes
+ * BACKBUF) - disabled by default
+ *
+ * The segments are split between the rendering threads, like the frame's jobs
+ * May be changed in `frame_setup`, to vary the sort from frame to frame
+ */
+extern sort_pass frame_sort;
+
+
 // The number of frames to render - defaults to one
 extern unsigned int n_frames;
 
 
+/*
+ * How jobs are handed out to threads - defaults to JOB_SCHED_QUEUE
+ *
+ * JOB_SCHED_QUEUE allocates and enqueues each job every frame
+ * JOB_SCHED_ATOMIC describes the frame's jobs once, and has threads claim them without locking
+ * JOB_SCHED_STEAL gives each thread a contiguous run of jobs, which other threads steal from
+ *                 once their own runs out - at least JOB_STEAL_SPLIT jobs are used per thread
+ * JOB_SCHED_WAVEFRONT starts each job of a frame as soon as the jobs of the previous frame within
+ *                     `stage_halo` pixels of it are complete, rather than once the whole frame
+ *                     is, so that the end of each frame overlaps the start of the next (and each
+ *                     frame is saved while the next is rendered)
+ * (see render_job.h)
+ *
+ * JOB_SCHED_WAVEFRONT requires the shader to stage BACKBUF (see `stage_backbuf`), with
+ * `stage_address` clamping or mirroring and `backbuf_format` left as FB_FORMAT_TUP3 (each frame
+ * is staged from the one before it, as rendered), and read it only through `staged_get`, as
+ * several frames are in progress at once (and each job only waits on its neighbours) - for the same reason,
+ * `frame_setup` is only called once (before the first frame), FRAME_COUNT and CLOCK_NS are not
+ * updated between frames, and neither adaptive jobs, sort passes, nor `stage_frames` are used
+ */
+extern job_sched sched_mode;
+
+
+/*
+ * How threads are synchronised between frames - defaults to FRAME_SYNC_SIGNAL
+ *
+ * FRAME_SYNC_BARRIER has all threads (and the main thread) meet at a barrier to start and
+ * end each frame, spinning briefly before sleeping, with the main thread rendering alongside
+ * the others - this suits high frame rates at small resolutions
+ * Only applies to JOB_SCHED_ATOMIC and JOB_SCHED_STEAL (see render_job.h)
+ */
+extern frame_sync sync_mode;
+
+
+/*
+ * Properties that a shader was specialised for, when compiled by `shaderc -r`, `-t` or `-j`
+ * - these are only defined in specialised shaders
+ *
+ * `frag_baked_threads` and `frag_baked_jobs` replace `n_threads` and `n_jobs` after `frag_init`
+ * `frag_baked_dim` is the only resolution that the shader can render at (as FRAME_DIM, and
+ * FRAG_DIM_X/FRAG_DIM_Y, are constants within it), so any other render frame is an error
+ */
+extern const unsigned int frag_baked_dim[2] __attribute__((weak));
+extern const unsigned int frag_baked_threads __attribute__((weak));
+extern const unsigned int frag_baked_jobs __attribute__((weak));
+
+
 // -----===[ Global Uniforms ]===-----
 
 /*
  * The previously rendered frame
  *
  * Initialised to all opaque black
+ * Should be read through this global each frame, as it may change (see `swap_backbuf`)
  */
 extern framebuf *BACKBUF;
 
 
+/*
+ * The frames rendered before BACKBUF, newest first from `backbuf_history[backbuf_history_head]`
+ * (a ring of `history_frames - 1` framebuffers, or NULL)
+ *
+ * Initialised to all opaque black, as BACKBUF - should be read through BACKBUF_N
+ */
+extern framebuf **backbuf_history;
+extern unsigned int backbuf_history_head;
+
+
 /*
  * The current frame number, starting at zero, and incrementing after each frame
  */
@@ -72,6 +363,35 @@ extern unsigned long long CLOCK_NS;
 extern tup3 FRAME_DIM;
 
 
+/*
+ * The index of the thread rendering the current pixel, from zero to `n_threads - 1`
+ * (or `n_threads` for the main thread, when it renders alongside the others)
+ *
+ * Can be used to index per-thread state (eg. an array of `n_threads + 1` caches)
+ */
+extern _Thread_local unsigned int WORKER_ID;
+
+
+/*
+ * The scratch arena of the thread rendering the current pixel (see scratch.h), or NULL if
+ * `scratch_size` is zero
+ *
+ * Memory from `scratch_alloc(WORKER_SCRATCH, n)` is never shared with another thread, and is
+ * reclaimed when the thread moves on to its next job - so can be reused across the pixels of a
+ * job (eg. to cache a window of samples), or released after each pixel with `scratch_mark` and
+ * `scratch_release`
+ */
+extern _Thread_local scratch_arena *WORKER_SCRATCH;
+
+
+/*
+ * The region of BACKBUF staged for the current job, if `stage_backbuf` is set
+ *
+ * Should be read through `staged_get`, with frame coordinates within the job or its halo
+ */
+extern _Thread_local staged_region STAGED;
+
+
 /*
  * A constant random value between 0.0 and 1.0, loaded at initialisation
  * (safe to use in `frag_init`)
@@ -79,11 +399,56 @@ extern tup3 FRAME_DIM;
 extern float CONST_RAND;
 
 
+// -----===[ Functions ]===-----
+
+/*
+ * Reads a pixel of BACKBUF from the current job's staged region (see `stage_backbuf`), without
+ * checking the coordinates
+ *
+ * IN:
+ *      [int] - the x coordinate (in the frame), within the job or `stage_halo` pixels of it
+ *      [int] - the y coordinate (in the frame), within the job or `stage_halo` pixels of it
+ *
+ * OUT: [tup3] - the pixel
+ */
+static inline tup3 staged_get(int x, int y)
+{
+    return STAGED.buf[(x - STAGED.x0) + (size_t) (y - STAGED.y0) * STAGED.w];
+}
+
+
+/*
+ * Finds one of the previous frames (see `history_frames`)
+ *
+ * IN:
+ *      [unsigned int] - how many frames before the current frame, from 1 (BACKBUF) to
+ *                       `history_frames` - later frames give the oldest frame kept
+ *
+ * OUT: [framebuf *] - the frame, which should be read each frame, as the ring rotates
+ */
+static inline framebuf *backbuf_n(unsigned int k)
+{
+    if (k > history_frames)
+    {
+        k = history_frames;
+    }
+
+    if (k <= 1)
+    {
+        return BACKBUF;
+    }
+
+    return backbuf_history[(backbuf_history_head + k - 2) % (history_frames - 1)];
+}
+
+
 // -----===[ External Functions ]===-----
 
 /*
  * Provides the functionality for the fragment shader, as run on a single pixel.
  *
+ * May be omitted if the shader provides `fragment_span`, `fragment_x8` or `group_fragment`
+ *
  * IN:
  *      [tup3 *] - the uv coordinates of the current pixel
  *                z and w components are undefined and should not be used
@@ -91,7 +456,110 @@ extern float CONST_RAND;
  * OUT: [tup3] - the resulting pixel colour
  *               w component is alpha channel, but may not be used by all output formats
  */
-extern tup3 fragment(tup3 *);
+extern tup3 fragment(tup3 *) __attribute__((weak));
+
+
+/*
+ * Optionally provides the functionality for the fragment shader, as run on a run of
+ * consecutive pixels within a single row - used instead of `fragment` if defined
+ *
+ * Called once for each segment (of at most FRAGMENT_SPAN_MAX pixels) of each row of a job,
+ * which lets a shader amortise per-call work, and process pixels in bulk
+ *
+ * IN:
+ *      [const tup3 *] - the uv coordinates of each pixel, left to right
+ *                       z and w components are undefined and should not be used
+ *      [unsigned int] - the number of pixels
+ *      [tup3 *] - the resulting pixel colours, to be written left to right
+ *                 (this is the render frame row itself)
+ *
+ * OUT: N/A
+ */
+extern void fragment_span(const tup3 *, unsigned int, tup3 *) __attribute__((weak));
+
+
+/*
+ * Optionally provides the functionality for the fragment shader, as run on a packet of
+ * up to eight horizontally adjacent pixels - used instead of `fragment` if defined
+ *
+ * Lanes past the end of a job's row are inactive, and hold the coordinates of the last
+ * active lane - their results are discarded (see tuple_x8.h)
+ *
+ * IN:
+ *      [tup3x8 *] - the uv coordinates of each pixel, left to right
+ *                  z and w components are undefined and should not be used
+ *      [mask8 *] - the active lanes
+ *
+ * OUT: [tup3x8] - the resulting pixel colours
+ */
+extern tup3x8 fragment_x8(tup3x8 *, mask8 *) __attribute__((weak));
+
+
+/*
+ * Optionally renders every pixel of a job with `fragment` - used instead of the core's own
+ * render loop if defined (but not over `fragment_span` or `fragment_x8`)
+ *
+ * Shall not be written by hand - expand FRAGMENT_RENDER_LOOP() (see render_loop.h) after
+ * `fragment`, so that the compiler sees the loop and `fragment` together
+ *
+ * IN:
+ *      [render_job *] - the job to render
+ *      [framebuf *] - the frame to render into
+ *
+ * OUT: N/A
+ */
+extern void fragment_render_job(render_job *, framebuf *) __attribute__((weak));
+
+
+/*
+ * Optionally renders every pixel of a group (of `group_w` by `group_h` pixels) at once - used
+ * instead of all other fragment functions if defined
+ *
+ * Suits shaders where neighbouring pixels share most of their work (eg. sorting a window of
+ * pixels, then writing each of them), which can then be done once per group
+ * `row_setup` is not called for groups
+ *
+ * IN:
+ *      [unsigned int] - the x coordinate of the group's top left pixel
+ *      [unsigned int] - the y coordinate of the group's top left pixel
+ *      [unsigned int] - the width of the group (smaller than `group_w` at the right edge)
+ *      [unsigned int] - the height of the group (smaller than `group_h` at the bottom edge)
+ *      [framebuf *] - the frame to write each pixel of the group into
+ *
+ * OUT: N/A
+ */
+extern void group_fragment(unsigned int, unsigned int, unsigned int, unsigned int, framebuf *)
+    __attribute__((weak));
+
+
+/*
+ * Optionally computes values that are the same for every pixel of a frame (eg. values
+ * derived from FRAME_COUNT or FRAME_DIM), so that they are not recomputed for each pixel
+ *
+ * Called once per frame on the main thread, before any pixel of the frame is rendered, and
+ * with the uniforms already updated - results can be stored in ordinary globals
+ *
+ * IN: N/A
+ *
+ * OUT: N/A
+ */
+extern void frame_setup(void) __attribute__((weak));
+
+
+/*
+ * Optionally computes values that are the same for every pixel of a row
+ *
+ * Called by the rendering thread before it renders the pixels of a row within a job, so may
+ * be called several times for one row (eg. once for each tile spanning it), concurrently on
+ * different threads - results should be stored in ROW_LOCAL globals, which each thread has
+ * its own copy of
+ *
+ * IN:
+ *      [unsigned int] - the y coordinate of the row
+ *
+ * OUT: N/A
+ */
+extern void row_setup(unsigned int) __attribute__((weak));
 
 
 /*
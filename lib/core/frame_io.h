@@ -10,6 +10,7 @@
 #include <stdlib.h>
 #include <unistd.h>
 #include <string.h>
+#include <pthread.h>
 #include "framebuffer.h"
 
 
@@ -44,6 +45,55 @@ typedef struct frame_output {
 } frame_output;
 
 
+/*
+ * A frame awaiting output by a frame_writer
+ *
+ * fb [framebuf *] - the frame to save
+ * framenum [unsigned long] - the frame number to save it as
+ */
+typedef struct pending_frame {
+    framebuf *fb;
+    unsigned long framenum;
+} pending_frame;
+
+
+/*
+ * A pipelined output stage, where frames are saved by dedicated writer threads
+ *
+ * Finished frames are handed to the writers in exchange for a spare framebuffer to render
+ * the next frame into, so that rendering continues while earlier frames are encoded
+ * The writer owns `depth` framebuffers - once all are awaiting output, handing over a
+ * frame blocks until one has been saved, which caps the memory used
+ *
+ * depth [unsigned int] - the number of framebuffers owned by the writer
+ * spare [framebuf **] - the framebuffers not awaiting output (room for depth + 1)
+ * n_spare [unsigned int] - the number of spare framebuffers
+ * pending [pending_frame *] - a ring of frames awaiting output, in order (room for depth + 1)
+ * pending_head [unsigned int] - the index of the oldest pending frame
+ * n_pending [unsigned int] - the number of frames awaiting output
+ * writers [pthread_t *] - the writer threads
+ * n_writers [unsigned int] - the number of writer threads
+ * lock [pthread_mutex_t] - protects all of the above
+ * has_pending [pthread_cond_t] - signalled when a frame is handed over
+ * has_spare [pthread_cond_t] - signalled when a frame has been saved
+ * quit [int] - set when the writers should exit, once all pending frames are saved
+ */
+typedef struct frame_writer {
+    unsigned int depth;
+    framebuf **spare;
+    unsigned int n_spare;
+    pending_frame *pending;
+    unsigned int pending_head;
+    unsigned int n_pending;
+    pthread_t *writers;
+    unsigned int n_writers;
+    pthread_mutex_t lock;
+    pthread_cond_t has_pending;
+    pthread_cond_t has_spare;
+    int quit;
+} frame_writer;
+
+
 // -----===[ Functions ]===-----
 
 /*
@@ -82,4 +132,65 @@ void free_frame_output(void);
  */
 void save_frame(framebuf *, unsigned long);
 
+
+// < Pipelined Output >
+
+/*
+ * Creates a frame writer, and starts its writer threads
+ *
+ * The spare framebuffers are not initialised, as each is fully rendered before being saved
+ *
+ * IN:
+ *      [unsigned int] - the number of framebuffers owned by the writer (pipeline depth)
+ *      [unsigned int] - the number of writer threads
+ *      [unsigned int] - the x dimension of each frame
+ *      [unsigned int] - the y dimension of each frame
+ *
+ * OUT: [frame_writer * | NULL] - the newly created frame writer
+ *                                NULL on memory or thread error
+ */
+frame_writer *fwriter_init(unsigned int, unsigned int, unsigned int, unsigned int);
+
+
+/*
+ * Waits for all pending frames to be saved, stops the writer threads, and deletes the
+ * frame writer (and all framebuffers it owns)
+ *
+ * IN:
+ *      [frame_writer *] - the frame writer to delete
+ *
+ * OUT: N/A
+ */
+void fwriter_delete(frame_writer *);
+
+
+/*
+ * Hands a frame to the writer threads to be saved (using the current configuration),
+ * passing ownership of the framebuffer to the writer
+ *
+ * IN:
+ *      [frame_writer *] - the frame writer
+ *      [framebuf *] - the frame to save
+ *      [unsigned long] - the frame number
+ *
+ * OUT: N/A
+ */
+void fwriter_submit(frame_writer *, framebuf *, unsigned long);
+
+
+/*
+ * Takes a spare framebuffer from the writer, waiting for a frame to be saved if there
+ * are none, passing ownership of the framebuffer to the caller
+ *
+ * A submitted frame that the caller still reads from (eg. as BACKBUF) can be excluded, so
+ * that it is not handed back out to be rendered into
+ *
+ * IN:
+ *      [frame_writer *] - the frame writer
+ *      [framebuf * | NULL] - a framebuffer that must not be taken (NULL for none)
+ *
+ * OUT: [framebuf *] - a spare framebuffer, with undefined contents
+ */
+framebuf *fwriter_acquire(frame_writer *, framebuf *);
+
 #endif
@@ -26,24 +26,124 @@
 #include <stdlib.h>
 #include <stdio.h>
 #include <fcntl.h>
+#include <stdint.h>
+#include <string.h>
 #include "tuple.h"
 
 // -----===[ Structures ]===-----
 
+/*
+ * How each pixel of a framebuf is stored
+ *
+ * FB_FORMAT_TUP3 stores a full tup3 (16 bytes) - the default, and the only format that can be
+ *                rendered into directly
+ * FB_FORMAT_RGBA8 stores each channel (including w) in 8 bits, clamped to [0, 1] (4 bytes)
+ * FB_FORMAT_RGBA16F stores each channel (including w) as a half float (8 bytes)
+ * FB_FORMAT_RGB32F stores the x, y and z channels as floats, with w read back as 1.0 (12 bytes)
+ */
+typedef enum fb_format {
+    FB_FORMAT_TUP3,
+    FB_FORMAT_RGBA8,
+    FB_FORMAT_RGBA16F,
+    FB_FORMAT_RGB32F
+} fb_format;
+
+
+/*
+ * How the pixels of a framebuf are laid out in memory
+ *
+ * FB_LAYOUT_LINEAR stores rows one after another (x + y * dimx) - the default, and the only
+ *                  layout that can be rendered into directly
+ * FB_LAYOUT_TILED stores square tiles (of FB_TILE_DIM pixels) one after another, in rows of
+ *                 tiles, with each tile's pixels in rows - so that pixels above and below one
+ *                 another usually share a page, and often a cache line
+ * FB_LAYOUT_MORTON stores tiles as FB_LAYOUT_TILED does, with each tile's pixels in Morton
+ *                  (Z) order - so that neighbourhoods are as compact as possible
+ *
+ * Tiles at the right and bottom edges are padded, so up to FB_TILE_DIM - 1 extra rows and
+ * columns of pixels are allocated
+ */
+typedef enum fb_layout {
+    FB_LAYOUT_LINEAR,
+    FB_LAYOUT_TILED,
+    FB_LAYOUT_MORTON
+} fb_layout;
+
+
+// The width and height (in pixels) of each tile of a tiled framebuf, as a power of two
+#define FB_TILE_SHIFT (3)
+#define FB_TILE_DIM (1u << FB_TILE_SHIFT)
+
+
 /*
  * The actual framebuf
  *
  * dimx [unsigned int] - the width of the framebuf
  * dimy [unsigned int] - the height of the framebuf
- * buf [tup3 *] - the actual framebuf buffer
+ * buf [tup3 * | NULL] - the actual framebuf buffer (NULL unless the format is FB_FORMAT_TUP3)
+ * data [void *] - the pixel buffer, in any format (the same as `buf` for FB_FORMAT_TUP3)
+ * format [fb_format] - how pixels are stored
+ * layout [fb_layout] - how pixels are laid out
+ * tiles_x [unsigned int] - the number of tiles in each row of tiles (if tiled)
  */
 typedef struct framebuf {
     unsigned int dimx;
     unsigned int dimy;
     tup3 *buf;
+    void *data;
+    fb_format format;
+    fb_layout layout;
+    unsigned int tiles_x;
 } framebuf;
 
 
+// Pixels in the compact formats, as vectors so that they are converted in a few instructions
+typedef float fb_f32x4 __attribute__((vector_size(16)));
+typedef int32_t fb_i32x4 __attribute__((vector_size(16)));
+typedef uint8_t fb_rgba8 __attribute__((vector_size(4)));
+typedef _Float16 fb_rgba16f __attribute__((vector_size(8)));
+
+typedef struct fb_rgb32f {
+    float x;
+    float y;
+    float z;
+} fb_rgb32f;
+
+
+/*
+ * How coordinates outside of a framebuf are mapped back into it when sampling
+ *
+ * FB_ADDR_CLAMP repeats the edge pixels
+ * FB_ADDR_WRAP tiles the framebuf
+ * FB_ADDR_MIRROR tiles the framebuf, reflecting every other tile (so edge pixels are doubled)
+ */
+typedef enum fb_address {
+    FB_ADDR_CLAMP,
+    FB_ADDR_WRAP,
+    FB_ADDR_MIRROR
+} fb_address;
+
+
+/*
+ * The direction in which a framebuf is split into lanes (rows or columns) to be sorted
+ */
+typedef enum sort_axis {
+    SORT_AXIS_ROWS,
+    SORT_AXIS_COLUMNS
+} sort_axis;
+
+
+/*
+ * A function that gives the key of a pixel to sort by
+ *
+ * IN:
+ *      [tup3 *] - the pixel
+ *
+ * OUT: [float [0, 1]] - the key of the pixel (clamped to the range)
+ */
+typedef float(*pixel_key)(tup3 *);
+
+
 // -----===[ Functions ]===-----
 
 // < Framebuffer Memory >
@@ -62,6 +162,95 @@ typedef struct framebuf {
 framebuf *framebuf_init(unsigned int, unsigned int);
 
 
+/*
+ * Creates a new framebuf of the given dimensions, without initialising any pixels
+ *
+ * As the pixel buffer is never written to, its pages are placed (first touched) by whichever
+ * threads first write to them - eg. on the NUMA node of the thread that renders that region
+ *
+ * IN:
+ *      [unsigned int] - the x dimension for the framebuf
+ *      [unsigned int] - the y dimension for the framebuf
+ *
+ * OUT: [framebuf * | NULL] - the newly created framebuf
+ *                            NULL on memory error
+ */
+framebuf *framebuf_alloc(unsigned int, unsigned int);
+
+
+/*
+ * Creates a new framebuf of the given dimensions and pixel format, with all pixels initialised
+ * to opaque black
+ *
+ * IN:
+ *      [unsigned int] - the x dimension for the framebuf
+ *      [unsigned int] - the y dimension for the framebuf
+ *      [fb_format] - how each pixel is stored
+ *
+ * OUT: [framebuf * | NULL] - the newly created framebuf
+ *                            NULL on memory error
+ */
+framebuf *framebuf_init_fmt(unsigned int, unsigned int, fb_format);
+
+
+/*
+ * Creates a new framebuf of the given dimensions and pixel format, without initialising any
+ * pixels (see framebuf_alloc)
+ *
+ * IN:
+ *      [unsigned int] - the x dimension for the framebuf
+ *      [unsigned int] - the y dimension for the framebuf
+ *      [fb_format] - how each pixel is stored
+ *
+ * OUT: [framebuf * | NULL] - the newly created framebuf
+ *                            NULL on memory error
+ */
+framebuf *framebuf_alloc_fmt(unsigned int, unsigned int, fb_format);
+
+
+/*
+ * Creates a new framebuf of the given dimensions, pixel format and layout, with all pixels
+ * initialised to opaque black
+ *
+ * IN:
+ *      [unsigned int] - the x dimension for the framebuf
+ *      [unsigned int] - the y dimension for the framebuf
+ *      [fb_format] - how each pixel is stored
+ *      [fb_layout] - how pixels are laid out
+ *
+ * OUT: [framebuf * | NULL] - the newly created framebuf
+ *                            NULL on memory error
+ */
+framebuf *framebuf_init_layout(unsigned int, unsigned int, fb_format, fb_layout);
+
+
+/*
+ * Creates a new framebuf of the given dimensions, pixel format and layout, without initialising
+ * any pixels (see framebuf_alloc)
+ *
+ * IN:
+ *      [unsigned int] - the x dimension for the framebuf
+ *      [unsigned int] - the y dimension for the framebuf
+ *      [fb_format] - how each pixel is stored
+ *      [fb_layout] - how pixels are laid out
+ *
+ * OUT: [framebuf * | NULL] - the newly created framebuf
+ *                            NULL on memory error
+ */
+framebuf *framebuf_alloc_layout(unsigned int, unsigned int, fb_format, fb_layout);
+
+
+/*
+ * Gives the size (in bytes) of a single pixel in the given format
+ *
+ * IN:
+ *      [fb_format] - the pixel format
+ *
+ * OUT: [size_t] - the size of a pixel
+ */
+size_t framebuf_px_size(fb_format);
+
+
 /*
  * Deletes a framebuf and frees the associated memory
  *
@@ -108,7 +297,8 @@ int framebuf_read(framebuf *, unsigned int, unsigned int, tup3 *);
 
 
 /*
- * Copies from one framebuffer into another - they must be of the same size
+ * Copies from one framebuffer into another - they must be of the same size, but may differ
+ * in format (pixels are converted) and layout
  *
  * IN:
  *      [framebuf *] - the framebuffer to copy into
@@ -119,4 +309,515 @@ int framebuf_read(framebuf *, unsigned int, unsigned int, tup3 *);
 int framebuf_copy(framebuf *, framebuf *);
 
 
+/*
+ * Copies a rectangular region from one framebuffer into another - they must be of the same size,
+ * but may differ in format (pixels are converted) and layout
+ *
+ * IN:
+ *      [framebuf *] - the framebuffer to copy into
+ *      [framebuf *] - the framebuffer to copy from
+ *      [unsigned int] - the starting x coordinate of the region
+ *      [unsigned int] - the ending x coordinate (exclusive) of the region
+ *      [unsigned int] - the starting y coordinate of the region
+ *      [unsigned int] - the ending y coordinate (exclusive) of the region
+ *
+ * OUT: [int] - 0 on success, positive on invalid sizing (or region), negative on source == dest
+ */
+int framebuf_copy_rect(framebuf *, framebuf *, unsigned int, unsigned int, unsigned int, unsigned int);
+
+
+/*
+ * Reads part of a row of a framebuf into linear memory, in any format or layout
+ *
+ * Tiled framebufs are de-tiled a run of pixels at a time, rather than per pixel
+ *
+ * IN:
+ *      [framebuf *] - the framebuf to read from
+ *      [unsigned int] - the starting x coordinate
+ *      [unsigned int] - the ending x coordinate (exclusive)
+ *      [unsigned int] - the y coordinate of the row
+ *      [tup3 *] - the pixels to read into (x_end - x_start of them)
+ *
+ * OUT: [int] - 0 on success, -1 if out of bounds
+ */
+int framebuf_read_row(framebuf *, unsigned int, unsigned int, unsigned int, tup3 *);
+
+
+/*
+ * Writes linear memory into part of a row of a framebuf, in any format or layout
+ *
+ * IN:
+ *      [framebuf *] - the framebuf to write to
+ *      [unsigned int] - the starting x coordinate
+ *      [unsigned int] - the ending x coordinate (exclusive)
+ *      [unsigned int] - the y coordinate of the row
+ *      [tup3 *] - the pixels to write (x_end - x_start of them)
+ *
+ * OUT: [int] - 0 on success, -1 if out of bounds
+ */
+int framebuf_write_row(framebuf *, unsigned int, unsigned int, unsigned int, tup3 *);
+
+
+// < Pixel Conversion >
+
+/*
+ * Converts a row of pixels into the given format
+ *
+ * IN:
+ *      [fb_format] - the format to convert into
+ *      [void *] - the pixels to write (in the given format)
+ *      [tup3 *] - the pixels to convert
+ *      [unsigned int] - the number of pixels
+ *
+ * OUT: N/A
+ */
+void framebuf_pack_row(fb_format, void *, tup3 *, unsigned int);
+
+
+/*
+ * Converts a row of pixels from the given format
+ *
+ * IN:
+ *      [fb_format] - the format to convert from
+ *      [tup3 *] - the pixels to write
+ *      [void *] - the pixels to convert (in the given format)
+ *      [unsigned int] - the number of pixels
+ *
+ * OUT: N/A
+ */
+void framebuf_unpack_row(fb_format, tup3 *, void *, unsigned int);
+
+
+/*
+ * Converts single pixels to and from each compact format
+ */
+static inline fb_rgba8 fb_pack_rgba8(tup3 *px)
+{
+    fb_f32x4 v;
+    fb_i32x4 i;
+
+    memcpy(&v, px, sizeof(fb_f32x4));
+
+    // Round, then clamp to [0, 255] with masks (a true comparison is all ones)
+    i = __builtin_convertvector(v * 255.0f + 0.5f, fb_i32x4);
+    i = (i & (i > 0)) | (i > 255);
+
+    return __builtin_convertvector(i & 255, fb_rgba8);
+}
+
+
+static inline tup3 fb_unpack_rgba8(fb_rgba8 p)
+{
+    fb_f32x4 v = __builtin_convertvector(p, fb_f32x4) * (1.0f / 255.0f);
+    tup3 res;
+
+    memcpy(&res, &v, sizeof(tup3));
+
+    return res;
+}
+
+
+static inline fb_rgba16f fb_pack_rgba16f(tup3 *px)
+{
+    fb_f32x4 v;
+
+    memcpy(&v, px, sizeof(fb_f32x4));
+
+    return __builtin_convertvector(v, fb_rgba16f);
+}
+
+
+static inline tup3 fb_unpack_rgba16f(fb_rgba16f p)
+{
+    fb_f32x4 v = __builtin_convertvector(p, fb_f32x4);
+    tup3 res;
+
+    memcpy(&res, &v, sizeof(tup3));
+
+    return res;
+}
+
+
+static inline fb_rgb32f fb_pack_rgb32f(tup3 *px)
+{
+    fb_rgb32f res = { px->x, px->y, px->z };
+
+    return res;
+}
+
+
+static inline tup3 fb_unpack_rgb32f(fb_rgb32f p)
+{
+    tup3 res = { p.x, p.y, p.z, 1.0f };
+
+    return res;
+}
+
+
+// < Unchecked Access >
+
+/*
+ * Spreads the lowest three bits (FB_TILE_SHIFT) of a coordinate out to every other bit
+ */
+static inline unsigned int fb_morton_spread(unsigned int v)
+{
+    return (v & 1u) | ((v & 2u) << 1) | ((v & 4u) << 2);
+}
+
+
+/*
+ * Gives the index (in pixels) of a pixel within a framebuf's pixel buffer, without checking
+ * the coordinates
+ *
+ * IN:
+ *      [framebuf *] - the framebuf
+ *      [unsigned int] - the x coordinate (0-indexed)
+ *      [unsigned int] - the y coordinate (0-indexed)
+ *
+ * OUT: [size_t] - the index of the pixel
+ */
+static inline size_t framebuf_index(framebuf *fb, unsigned int x, unsigned int y)
+{
+    if (fb->layout == FB_LAYOUT_LINEAR)
+    {
+        return x + (size_t) y * fb->dimx;
+    }
+
+    size_t tile = (x >> FB_TILE_SHIFT) + (size_t) (y >> FB_TILE_SHIFT) * fb->tiles_x;
+    unsigned int tx = x & (FB_TILE_DIM - 1);
+    unsigned int ty = y & (FB_TILE_DIM - 1);
+
+    if (fb->layout == FB_LAYOUT_MORTON)
+    {
+        return (tile << (2 * FB_TILE_SHIFT)) | fb_morton_spread(tx) | (fb_morton_spread(ty) << 1);
+    }
+
+    return (tile << (2 * FB_TILE_SHIFT)) | tx | (ty << FB_TILE_SHIFT);
+}
+
+
+/*
+ * Gives the address of a pixel in a framebuf, without checking the coordinates
+ *
+ * Suits loops over ranges that are already known to be within the framebuf (eg. a render
+ * job, or a group) - out of bounds coordinates are undefined behaviour
+ * Only valid for FB_FORMAT_TUP3 framebufs - use framebuf_get and framebuf_set for others
+ *
+ * IN:
+ *      [framebuf *] - the framebuf
+ *      [unsigned int] - the x coordinate (0-indexed)
+ *      [unsigned int] - the y coordinate (0-indexed)
+ *
+ * OUT: [tup3 *] - the pixel
+ */
+static inline tup3 *framebuf_px(framebuf *fb, unsigned int x, unsigned int y)
+{
+    return fb->buf + framebuf_index(fb, x, y);
+}
+
+
+/*
+ * Reads a pixel from a framebuf, without checking the coordinates (see framebuf_px), converting
+ * it from the framebuf's format
+ *
+ * IN:
+ *      [framebuf *] - the framebuf to read from
+ *      [unsigned int] - the x coordinate (0-indexed)
+ *      [unsigned int] - the y coordinate (0-indexed)
+ *
+ * OUT: [tup3] - the pixel
+ */
+static inline tup3 framebuf_get(framebuf *fb, unsigned int x, unsigned int y)
+{
+    size_t i = framebuf_index(fb, x, y);
+
+    switch (fb->format)
+    {
+        case FB_FORMAT_RGBA8:
+            return fb_unpack_rgba8(((fb_rgba8 *) fb->data)[i]);
+
+        case FB_FORMAT_RGBA16F:
+            return fb_unpack_rgba16f(((fb_rgba16f *) fb->data)[i]);
+
+        case FB_FORMAT_RGB32F:
+            return fb_unpack_rgb32f(((fb_rgb32f *) fb->data)[i]);
+
+        default:
+            return fb->buf[i];
+    }
+}
+
+
+/*
+ * Writes a pixel into a framebuf, without checking the coordinates (see framebuf_px), converting
+ * it into the framebuf's format
+ *
+ * IN:
+ *      [framebuf *] - the framebuf to write to
+ *      [unsigned int] - the x coordinate (0-indexed)
+ *      [unsigned int] - the y coordinate (0-indexed)
+ *      [tup3 *] - the colour tuple to write in
+ *
+ * OUT: N/A
+ */
+static inline void framebuf_set(framebuf *fb, unsigned int x, unsigned int y, tup3 *colour)
+{
+    size_t i = framebuf_index(fb, x, y);
+
+    switch (fb->format)
+    {
+        case FB_FORMAT_RGBA8:
+            ((fb_rgba8 *) fb->data)[i] = fb_pack_rgba8(colour);
+            break;
+
+        case FB_FORMAT_RGBA16F:
+            ((fb_rgba16f *) fb->data)[i] = fb_pack_rgba16f(colour);
+            break;
+
+        case FB_FORMAT_RGB32F:
+            ((fb_rgb32f *) fb->data)[i] = fb_pack_rgb32f(colour);
+            break;
+
+        default:
+            fb->buf[i] = *colour;
+            break;
+    }
+}
+
+
+// < Sampling >
+
+/*
+ * Maps a coordinate into [0, n) by repeating the edges
+ */
+static inline unsigned int fb_addr_clamp(int i, unsigned int n)
+{
+    return i < 0 ? 0 : ((unsigned int) i >= n ? n - 1 : (unsigned int) i);
+}
+
+
+/*
+ * Maps a coordinate into [0, n) by tiling
+ */
+static inline unsigned int fb_addr_wrap(int i, unsigned int n)
+{
+    long long m = (long long) i % n;
+
+    return (unsigned int) (m < 0 ? m + n : m);
+}
+
+
+/*
+ * Maps a coordinate into [0, n) by tiling, reflecting every other tile
+ */
+static inline unsigned int fb_addr_mirror(int i, unsigned int n)
+{
+    unsigned int m = fb_addr_wrap(i, 2 * n);
+
+    return m < n ? m : 2 * n - 1 - m;
+}
+
+
+/*
+ * Reads a pixel from a framebuf, clamping coordinates outside of it to the nearest edge
+ *
+ * IN:
+ *      [framebuf *] - the framebuf to read from
+ *      [int] - the x coordinate (0-indexed, may be outside the framebuf)
+ *      [int] - the y coordinate (0-indexed, may be outside the framebuf)
+ *
+ * OUT: [tup3] - the pixel
+ */
+static inline tup3 framebuf_sample_clamp(framebuf *fb, int x, int y)
+{
+    return framebuf_get(fb, fb_addr_clamp(x, fb->dimx), fb_addr_clamp(y, fb->dimy));
+}
+
+
+/*
+ * Reads a pixel from a framebuf, wrapping coordinates outside of it around to the other side
+ *
+ * IN:
+ *      [framebuf *] - the framebuf to read from
+ *      [int] - the x coordinate (0-indexed, may be outside the framebuf)
+ *      [int] - the y coordinate (0-indexed, may be outside the framebuf)
+ *
+ * OUT: [tup3] - the pixel
+ */
+static inline tup3 framebuf_sample_wrap(framebuf *fb, int x, int y)
+{
+    return framebuf_get(fb, fb_addr_wrap(x, fb->dimx), fb_addr_wrap(y, fb->dimy));
+}
+
+
+/*
+ * Reads a pixel from a framebuf, reflecting coordinates outside of it back in at the edges
+ *
+ * IN:
+ *      [framebuf *] - the framebuf to read from
+ *      [int] - the x coordinate (0-indexed, may be outside the framebuf)
+ *      [int] - the y coordinate (0-indexed, may be outside the framebuf)
+ *
+ * OUT: [tup3] - the pixel
+ */
+static inline tup3 framebuf_sample_mirror(framebuf *fb, int x, int y)
+{
+    return framebuf_get(fb, fb_addr_mirror(x, fb->dimx), fb_addr_mirror(y, fb->dimy));
+}
+
+
+/*
+ * Maps a coordinate into [0, n) with the given addressing mode
+ */
+static inline unsigned int fb_addr(int i, unsigned int n, fb_address mode)
+{
+    switch (mode)
+    {
+        case FB_ADDR_WRAP:
+            return fb_addr_wrap(i, n);
+
+        case FB_ADDR_MIRROR:
+            return fb_addr_mirror(i, n);
+
+        default:
+            return fb_addr_clamp(i, n);
+    }
+}
+
+
+/*
+ * Reads a pixel from a framebuf, with the given addressing mode for coordinates outside of it
+ *
+ * Prefer the mode-specific functions when the mode is fixed, as the mode is then not
+ * checked per sample
+ *
+ * IN:
+ *      [framebuf *] - the framebuf to read from
+ *      [int] - the x coordinate (0-indexed, may be outside the framebuf)
+ *      [int] - the y coordinate (0-indexed, may be outside the framebuf)
+ *      [fb_address] - how to map coordinates outside of the framebuf
+ *
+ * OUT: [tup3] - the pixel
+ */
+static inline tup3 framebuf_sample(framebuf *fb, int x, int y, fb_address mode)
+{
+    return framebuf_get(fb, fb_addr(x, fb->dimx, mode), fb_addr(y, fb->dimy, mode));
+}
+
+
+// < Gathering >
+
+/*
+ * Reads a run of pixels along a row of a framebuf into a buffer, mapping any coordinates outside
+ * of the framebuf back into it
+ *
+ * The addressing mode is only applied to pixels beyond the edges - the rest are read as runs
+ *
+ * IN:
+ *      [framebuf *] - the framebuf to read from
+ *      [int] - the x coordinate of the first pixel (may be outside the framebuf)
+ *      [int] - the y coordinate of the row (may be outside the framebuf)
+ *      [unsigned int] - the number of pixels to read
+ *      [fb_address] - how to map coordinates outside of the framebuf
+ *      [tup3 *] - the buffer to read into
+ *
+ * OUT: N/A
+ */
+void framebuf_gather_row(framebuf *, int, int, unsigned int, fb_address, tup3 *);
+
+
+/*
+ * Reads a run of pixels down a column of a framebuf into a buffer (see framebuf_gather_row)
+ *
+ * IN:
+ *      [framebuf *] - the framebuf to read from
+ *      [int] - the x coordinate of the column (may be outside the framebuf)
+ *      [int] - the y coordinate of the first pixel (may be outside the framebuf)
+ *      [unsigned int] - the number of pixels to read
+ *      [fb_address] - how to map coordinates outside of the framebuf
+ *      [tup3 *] - the buffer to read into
+ *
+ * OUT: N/A
+ */
+void framebuf_gather_col(framebuf *, int, int, unsigned int, fb_address, tup3 *);
+
+
+/*
+ * Reads a rectangle of pixels (eg. a stencil neighbourhood) of a framebuf into a buffer, row by
+ * row (see framebuf_gather_row)
+ *
+ * IN:
+ *      [framebuf *] - the framebuf to read from
+ *      [int] - the x coordinate of the top left pixel (may be outside the framebuf)
+ *      [int] - the y coordinate of the top left pixel (may be outside the framebuf)
+ *      [unsigned int] - the width of the rectangle
+ *      [unsigned int] - the height of the rectangle
+ *      [fb_address] - how to map coordinates outside of the framebuf
+ *      [tup3 *] - the buffer to read into (width * height pixels)
+ *
+ * OUT: N/A
+ */
+void framebuf_gather_rect(framebuf *, int, int, unsigned int, unsigned int, fb_address, tup3 *);
+
+
+// < Framebuffer Sorting >
+
+/*
+ * Sorts each segment of each lane (row or column) of a framebuf, in place, by ascending key
+ *
+ * Segments tile each lane from its start, with the last being shorter if the lane is not a
+ * multiple of the segment length
+ * Keys are quantised to 16 bits, and segments are radix sorted - pixels with equal (quantised)
+ * keys keep their order
+ *
+ * IN:
+ *      [framebuf *] - the framebuf to sort
+ *      [sort_axis] - whether to sort along rows or columns
+ *      [unsigned int] - the length of each segment (0 for whole lanes)
+ *      [pixel_key | NULL] - the key to sort by (NULL for luminance)
+ *
+ * OUT: [int] - 0 on success, -1 on memory error
+ */
+int framebuf_sort_segments(framebuf *, sort_axis, unsigned int, pixel_key);
+
+
+/*
+ * Sorts the segments of a range of lanes of a framebuf (see framebuf_sort_segments), so that
+ * disjoint ranges can be sorted in parallel
+ *
+ * IN:
+ *      [framebuf *] - the framebuf to sort
+ *      [sort_axis] - whether to sort along rows or columns
+ *      [unsigned int] - the length of each segment (0 for whole lanes)
+ *      [pixel_key | NULL] - the key to sort by (NULL for luminance)
+ *      [unsigned int] - the first lane (row or column index) to sort
+ *      [unsigned int] - the lane to stop before
+ *
+ * OUT: [int] - 0 on success, -1 on memory error
+ */
+int framebuf_sort_lanes(framebuf *, sort_axis, unsigned int, pixel_key, unsigned int, unsigned int);
+
+
+/*
+ * Gives the relative luminance of a pixel (Rec. 709 weights)
+ *
+ * IN:
+ *      [tup3 *] - the pixel
+ *
+ * OUT: [float [0, 1]] - the luminance
+ */
+float pixel_luminance(tup3 *);
+
+
+/*
+ * Gives the hue of a pixel, as a fraction of a full turn starting from red
+ *
+ * IN:
+ *      [tup3 *] - the pixel
+ *
+ * OUT: [float [0, 1)] - the hue (0 for greys)
+ */
+float pixel_hue(tup3 *);
+
+
 #endif
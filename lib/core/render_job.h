@@ -3,16 +3,87 @@
  *
  * Each job defines either a region of the framebuffer to compute,
  * or is a quit signal
+ *
+ * Also provides a job dispenser - a fixed set of jobs that is described once
+ * and then claimed by workers without locking, as an alternative to the queue
+ * The dispenser can optionally split its jobs between per-worker deques, which
+ * workers steal from when their own runs out
+ *
+ * Also provides a job wavefront - a fixed set of jobs rendered over many frames at once, where
+ * each job of a frame becomes ready as soon as the jobs it depends upon in the previous frame are
  */
 
 #ifndef RENDER_JOB_H
 #define RENDER_JOB_H
 
 #include <pthread.h>
+#include <stdatomic.h>
 #include <stdlib.h>
 
 // -----===[ Structures ]===-----
 
+/*
+ * The strategy by which render jobs are handed out to worker threads
+ *
+ * JOB_SCHED_QUEUE - jobs are allocated every frame and passed through a job_queue
+ * JOB_SCHED_ATOMIC - jobs are described once in a job_dispenser, and workers claim
+ *                    them with a single atomic increment
+ * JOB_SCHED_STEAL - jobs are described once in a job_dispenser, and each worker is given
+ *                   a contiguous run of them, stealing from other workers when it runs out
+ * JOB_SCHED_WAVEFRONT - jobs are described once in a job_wavefront, and each job of a frame is
+ *                       handed out once the nearby jobs of the previous frame are complete,
+ *                       without waiting for the whole frame
+ */
+typedef enum job_sched {
+    JOB_SCHED_QUEUE,
+    JOB_SCHED_ATOMIC,
+    JOB_SCHED_STEAL,
+    JOB_SCHED_WAVEFRONT,
+} job_sched;
+
+
+/*
+ * The order in which the tiles of a frame are issued as jobs
+ *
+ * TILE_ORDER_ROW - row by row, left to right
+ * TILE_ORDER_MORTON - along a Z-order (Morton) curve
+ * TILE_ORDER_HILBERT - along a Hilbert curve, so that consecutive tiles always share an edge
+ */
+typedef enum tile_order {
+    TILE_ORDER_ROW,
+    TILE_ORDER_MORTON,
+    TILE_ORDER_HILBERT,
+} tile_order;
+
+
+/*
+ * How the threads working through a job dispenser are synchronised between frames
+ *
+ * FRAME_SYNC_SIGNAL - workers sleep on a condition variable until each frame starts,
+ *                     while the main thread sleeps until the last job completes
+ * FRAME_SYNC_BARRIER - the main thread and workers meet at a reusable barrier to start
+ *                      and end each frame, spinning briefly before sleeping, and the main
+ *                      thread claims jobs alongside the workers
+ */
+typedef enum frame_sync {
+    FRAME_SYNC_SIGNAL,
+    FRAME_SYNC_BARRIER,
+} frame_sync;
+
+
+/*
+ * The number of times a thread checks a frame barrier before sleeping on it
+ */
+#define FRAME_BARRIER_SPIN (4096)
+
+
+/*
+ * The minimum number of jobs to plan per thread when work stealing, so that there
+ * is always something to steal when the per-pixel cost is uneven
+ */
+#define JOB_STEAL_SPLIT (16)
+
+
 /*
  * A render job
  *
@@ -22,6 +93,8 @@
  * y_end [unsigned int] - the ending y coordinate (exclusive) of the render job
  * next [render_job *] - a link to the next job in the queue (for internal use only)
  * quit [int] - a flag for if this job is signalling that the job handler should quit
+ * in_arena [int] - a flag for if this job is part of a persistent array of jobs (an arena),
+ *                  rather than individually allocated - such jobs are never freed by `job_delete`
  */
 typedef struct render_job {
     unsigned int x_start;
@@ -30,6 +103,7 @@ typedef struct render_job {
     unsigned int y_end;
     struct render_job *next;
     unsigned int quit: 1;
+    unsigned int in_arena: 1;
 } render_job;
 
 
@@ -56,6 +130,152 @@ typedef struct job_queue {
 } job_queue;
 
 
+/*
+ * A map of the measured cost of each region of a frame
+ *
+ * The frame is divided into a grid of cells, where every job covers whole cells,
+ * so that threads recording their jobs' costs never write to the same cell
+ *
+ * dimx [unsigned int] - the x dimension of the frame
+ * dimy [unsigned int] - the y dimension of the frame
+ * cell_w [unsigned int] - the x dimension of each cell
+ * cell_h [unsigned int] - the y dimension of each cell
+ * cells_x [unsigned int] - the number of cells in each row of the grid
+ * cells_y [unsigned int] - the number of cells in each column of the grid
+ * cost [float *] - the cost (ns) of each cell, as last measured
+ */
+typedef struct job_costmap {
+    unsigned int dimx;
+    unsigned int dimy;
+    unsigned int cell_w;
+    unsigned int cell_h;
+    unsigned int cells_x;
+    unsigned int cells_y;
+    float *cost;
+} job_costmap;
+
+
+/*
+ * A deque of job indices owned by a single worker
+ *
+ * The owner takes jobs from the front, and other workers steal from the back
+ * Both ends are packed into a single word, so that each take is a single compare-and-swap
+ * Aligned so that each deque sits on its own cache line
+ *
+ * range [atomic_ullong] - the front index (upper 32 bits) and back index, exclusive (lower 32 bits)
+ */
+typedef struct job_deque {
+    _Alignas(64) atomic_ullong range;
+} job_deque;
+
+
+/*
+ * A reusable barrier, which spins for a bounded time before sleeping
+ *
+ * n_threads [atomic_uint] - the number of threads that must arrive to pass the barrier
+ * arrived [atomic_uint] - the number of threads that have arrived in the current phase
+ * phase [atomic_uint] - incremented each time the barrier is passed
+ * parked [atomic_uint] - the number of threads sleeping on the barrier
+ * park_lock [pthread_mutex_t] - a lock upon sleeping on, or waking, the barrier
+ * is_passed [pthread_cond_t] - a condition variable signaling when the barrier has been passed
+ */
+typedef struct frame_barrier {
+    atomic_uint n_threads;
+    atomic_uint arrived;
+    atomic_uint phase;
+    atomic_uint parked;
+    pthread_mutex_t park_lock;
+    pthread_cond_t is_passed;
+} frame_barrier;
+
+
+/*
+ * A fixed set of jobs, which are claimed by workers in order without locking
+ *
+ * The jobs are built once and reused for every frame - only the counters are reset
+ *
+ * jobs [render_job *] - the jobs making up a single frame
+ * n_jobs [unsigned int] - the number of jobs in a frame
+ * next [atomic_ullong] - the number of jobs in the current frame (upper 32 bits), and the index
+ *                        of the next job to be claimed (lower 32 bits) - as the number is fixed
+ *                        when a frame is started, `jobs` and `n_jobs` may be changed between frames
+ * remaining [atomic_uint] - the number of jobs in the current frame that are incomplete
+ * generation [unsigned long] - the number of frames that have been started
+ * quit [int] - a flag for if the workers should quit
+ * frame_lock [pthread_mutex_t] - a lock upon starting, finishing or quitting a frame
+ * frame_start [pthread_cond_t] - a condition variable signaling when a frame is started
+ *                                (or workers should quit)
+ * frame_done [pthread_cond_t] - a condition variable signaling when there are no remaining jobs
+ * deques [job_deque * | NULL] - the per-worker deques (NULL if not work stealing)
+ * n_deques [unsigned int] - the number of per-worker deques
+ * barrier [frame_barrier * | NULL] - the barrier starting and ending each frame
+ *                                    (NULL if synchronised by signals)
+ */
+typedef struct job_dispenser {
+    struct render_job *jobs;
+    unsigned int n_jobs;
+    struct job_deque *deques;
+    unsigned int n_deques;
+    struct frame_barrier *barrier;
+    atomic_ullong next;
+    atomic_uint remaining;
+    unsigned long generation;
+    int quit;
+    pthread_mutex_t frame_lock;
+    pthread_cond_t frame_start;
+    pthread_cond_t frame_done;
+} job_dispenser;
+
+
+/*
+ * A fixed set of jobs, rendered over many frames without waiting for each frame to complete
+ *
+ * Each job of a frame depends upon the jobs of the previous frame whose regions lie within a radius
+ * of its own (itself included), and becomes ready once they are complete
+ * As frames are rendered into two alternating framebuffers, each job also depends upon the frame
+ * two before its own having been released (eg. once it has been saved)
+ *
+ * jobs [render_job *] - the jobs making up a single frame
+ * n_jobs [unsigned int] - the number of jobs in a frame
+ * n_frames [unsigned long] - the number of frames to render
+ * dep_start [unsigned int *] - the index of each job's first dependency in `deps` (followed by
+ *                              the total number of dependencies)
+ * deps [unsigned int * | NULL] - the jobs that each job depends upon - which are also the jobs
+ *                                that depend upon it, in the next frame
+ * pending [atomic_uint *] - the number of unmet dependencies of each job, in each of the next two
+ *                           frames (indexed by job * 2 + frame % 2)
+ * remaining [atomic_uint[2]] - the number of incomplete jobs of each of the two latest frames
+ *                              (indexed by frame % 2)
+ * ready [unsigned long long *] - a ring of the jobs that are ready, each as its frame (upper 32
+ *                                bits) and index (lower 32 bits), with space for two frames
+ * ready_head [unsigned int] - the index of the first ready job in the ring
+ * ready_count [unsigned int] - the number of ready jobs in the ring
+ * completed [unsigned long] - the number of frames that are complete
+ * quit [int] - a flag for if the workers should quit
+ * ready_lock [pthread_mutex_t] - a lock upon the ring of ready jobs, and completing a frame
+ * is_ready [pthread_cond_t] - a condition variable signaling when a job is ready (or workers
+ *                             should quit)
+ * frame_done [pthread_cond_t] - a condition variable signaling when a frame is complete
+ */
+typedef struct job_wavefront {
+    struct render_job *jobs;
+    unsigned int n_jobs;
+    unsigned long n_frames;
+    unsigned int *dep_start;
+    unsigned int *deps;
+    atomic_uint *pending;
+    atomic_uint remaining[2];
+    unsigned long long *ready;
+    unsigned int ready_head;
+    unsigned int ready_count;
+    unsigned long completed;
+    int quit;
+    pthread_mutex_t ready_lock;
+    pthread_cond_t is_ready;
+    pthread_cond_t frame_done;
+} job_wavefront;
+
+
 // -----===[ Job Queue Functions ]===-----
 
 /*
@@ -70,7 +290,7 @@ job_queue *jobq_init(void);
 
 
 /*
- * Deletes a job_queue and any existing jobs
+ * Deletes a job_queue and any existing jobs (that are not part of an arena)
  *
  * Does not respect synchronisation, should only be used at cleanup
  *
@@ -100,6 +320,25 @@ void jobq_delete(job_queue *);
 void jobq_enqueue(job_queue *, render_job *);
 
 
+/*
+ * Enqueues a batch of jobs (eg. every job of a frame) with a single acquisition of the mutex
+ *
+ * The jobs are linked together in the order given, and must not already be in a queue
+ *
+ * Broadcasts the "non-empty" condition once (may wake up all waiting threads)
+ *
+ * Also increments the number of outstanding jobs by the number of jobs given
+ *
+ * IN:
+ *      [job_queue *] - the job queue to enqueue to
+ *      [render_job *] - an array of jobs to enqueue
+ *      [unsigned int] - the number of jobs in the array
+ *
+ * OUT: N/A
+ */
+void jobq_enqueue_batch(job_queue *, render_job *, unsigned int);
+
+
 /*
  * Dequeues a job
  *
@@ -111,7 +350,7 @@ void jobq_enqueue(job_queue *, render_job *);
  * IN:
  *      [job_queue *] - the job queue to dequeue from
  *
- * OUT: [render_job *] - the dequeued job (must be freed)
+ * OUT: [render_job *] - the dequeued job (must be freed with `job_delete`)
  */
 render_job *jobq_dequeue(job_queue *);
 
@@ -140,6 +379,351 @@ void jobq_report_complete(job_queue *);
 void jobq_wait_complete(job_queue *);
 
 
+// -----===[ Job Dispenser Functions ]===-----
+
+/*
+ * Creates a new job dispenser, with space for the given number of jobs
+ *
+ * The jobs themselves are left uninitialised, and should be filled in
+ * (eg. by `job_plan_bands`) before the first frame is started
+ *
+ * IN:
+ *      [unsigned int] - the number of jobs per frame
+ *
+ * OUT: [job_dispenser * | NULL] - the newly created job dispenser
+ *                                 NULL on error
+ */
+job_dispenser *jobd_init(unsigned int);
+
+
+/*
+ * Enables work stealing on a job dispenser, creating a deque for each worker
+ *
+ * Each frame, the jobs are split into contiguous runs (in order) between the deques
+ *
+ * IN:
+ *      [job_dispenser *] - the job dispenser to enable work stealing on
+ *      [unsigned int] - the number of workers
+ *
+ * OUT: [int] - 0 on success, -1 on memory error
+ */
+int jobd_enable_stealing(job_dispenser *, unsigned int);
+
+
+/*
+ * Enables barrier synchronisation on a job dispenser
+ *
+ * Every frame is then started and ended by all participants (the main thread included)
+ * meeting at a barrier, rather than by signals
+ *
+ * IN:
+ *      [job_dispenser *] - the job dispenser to enable barrier synchronisation on
+ *      [unsigned int] - the number of participants (workers and the main thread)
+ *
+ * OUT: [int] - 0 on success, -1 on error
+ */
+int jobd_enable_barrier(job_dispenser *, unsigned int);
+
+
+/*
+ * Deletes a job dispenser and its jobs
+ *
+ * Does not respect synchronisation, should only be used at cleanup
+ *
+ * IN:
+ *      [job_dispenser *] - the job dispenser to delete
+ *
+ * OUT: N/A
+ */
+void jobd_delete(job_dispenser *);
+
+
+/*
+ * Starts a new frame, making all jobs available to be claimed
+ *
+ * Signals the "frame start" condition (wakes up all waiting threads)
+ * With a barrier, instead waits at the barrier for all workers
+ *
+ * IN:
+ *      [job_dispenser *] - the job dispenser to start a frame on
+ *
+ * OUT: N/A
+ */
+void jobd_start_frame(job_dispenser *);
+
+
+/*
+ * Waits until a frame newer than the last one seen has been started, or until
+ * workers have been told to quit
+ *
+ * With a barrier, waits at the barrier (the generation is unused)
+ *
+ * IN:
+ *      [job_dispenser *] - the job dispenser to wait on
+ *      [unsigned long *] - the last generation seen by the caller (updated on return)
+ *
+ * OUT: [int] - 1 if a new frame has started
+ *              0 if the caller should quit
+ */
+int jobd_wait_frame(job_dispenser *, unsigned long *);
+
+
+/*
+ * Claims the next job of the current frame
+ *
+ * Does not block, and does not decrement the remaining jobs - this should be done
+ * once the job is actually completed
+ *
+ * IN:
+ *      [job_dispenser *] - the job dispenser to claim from
+ *
+ * OUT: [render_job * | NULL] - the claimed job (owned by the dispenser, must not be freed)
+ *                              NULL if all jobs of the frame have been claimed
+ */
+render_job *jobd_claim(job_dispenser *);
+
+
+/*
+ * Claims a job of the current frame from a worker's own deque, or steals one from
+ * another worker's deque (starting at a random victim) if its own is empty
+ *
+ * Work stealing must be enabled on the dispenser
+ * Does not block, and does not decrement the remaining jobs
+ *
+ * IN:
+ *      [job_dispenser *] - the job dispenser to claim from
+ *      [unsigned int] - the index of the claiming worker
+ *      [unsigned int *] - the worker's random state, for picking victims (must be non-zero)
+ *
+ * OUT: [render_job * | NULL] - the claimed job (owned by the dispenser, must not be freed)
+ *                              NULL if all jobs of the frame have been claimed
+ */
+render_job *jobd_claim_local(job_dispenser *, unsigned int, unsigned int *);
+
+
+/*
+ * Reduces the remaining jobs of the current frame by the given number of completed jobs
+ *
+ * Will signal all waiting threads if this results in zero remaining jobs
+ * With a barrier, instead waits at the barrier until all participants have finished the frame
+ *
+ * IN:
+ *      [job_dispenser *] - the job dispenser from which jobs were completed
+ *      [unsigned int] - the number of jobs completed
+ *
+ * OUT: N/A
+ */
+void jobd_report_complete(job_dispenser *, unsigned int);
+
+
+/*
+ * Waits until all jobs of the current frame have been completed
+ *
+ * With a barrier, the caller counts as a participant that has no jobs to report
+ *
+ * IN:
+ *      [job_dispenser *] - the job dispenser to wait on
+ *
+ * OUT: N/A
+ */
+void jobd_wait_complete(job_dispenser *);
+
+
+/*
+ * Signals all workers waiting on the dispenser to quit
+ *
+ * With a barrier, waits at the barrier to release the workers
+ *
+ * IN:
+ *      [job_dispenser *] - the job dispenser to quit
+ *
+ * OUT: N/A
+ */
+void jobd_quit(job_dispenser *);
+
+
+// -----===[ Job Wavefront Functions ]===-----
+
+/*
+ * Creates a new job wavefront, with space for the given number of jobs
+ *
+ * The jobs themselves are left uninitialised, and should be filled in (eg. by `job_plan_tiles`),
+ * then linked by `jobw_link`, before the first frame is started
+ *
+ * IN:
+ *      [unsigned int] - the number of jobs per frame
+ *
+ * OUT: [job_wavefront * | NULL] - the newly created job wavefront
+ *                                 NULL on error
+ */
+job_wavefront *jobw_init(unsigned int);
+
+
+/*
+ * Deletes a job wavefront and its jobs
+ *
+ * Does not respect synchronisation, should only be used at cleanup
+ *
+ * IN:
+ *      [job_wavefront *] - the job wavefront to delete
+ *
+ * OUT: N/A
+ */
+void jobw_delete(job_wavefront *);
+
+
+/*
+ * Determines the dependencies of each job - the jobs whose regions lie within the given radius
+ * of its own (in both axes)
+ *
+ * IN:
+ *      [job_wavefront *] - the job wavefront to link
+ *      [unsigned int] - the radius (in pixels) that each pixel reads from the previous frame
+ *
+ * OUT: [int] - 0 on success, -1 on memory error
+ */
+int jobw_link(job_wavefront *, unsigned int);
+
+
+/*
+ * Starts rendering the given number of frames, making every job of the first frame ready
+ *
+ * Broadcasts the "ready" condition (wakes up all waiting threads)
+ *
+ * IN:
+ *      [job_wavefront *] - the job wavefront to start
+ *      [unsigned long] - the number of frames to render
+ *
+ * OUT: N/A
+ */
+void jobw_start(job_wavefront *, unsigned long);
+
+
+/*
+ * Claims a ready job, of any frame
+ *
+ * Waits until a job is ready, or until workers have been told to quit
+ *
+ * IN:
+ *      [job_wavefront *] - the job wavefront to claim from
+ *      [unsigned long *] - the frame that the claimed job belongs to (set on return)
+ *
+ * OUT: [render_job * | NULL] - the claimed job (owned by the wavefront, must not be freed)
+ *                              NULL if the caller should quit
+ */
+render_job *jobw_claim(job_wavefront *, unsigned long *);
+
+
+/*
+ * Reports a claimed job as complete, making any jobs of the next frame that were waiting only
+ * on it ready
+ *
+ * Signals the "ready" condition for each job made ready, and broadcasts the "frame done"
+ * condition if this completes the frame
+ *
+ * IN:
+ *      [job_wavefront *] - the job wavefront from which the job was claimed
+ *      [render_job *] - the completed job
+ *      [unsigned long] - the frame that the job belongs to
+ *
+ * OUT: N/A
+ */
+void jobw_report_complete(job_wavefront *, render_job *, unsigned long);
+
+
+/*
+ * Waits until every job of the given frame has been completed
+ *
+ * IN:
+ *      [job_wavefront *] - the job wavefront to wait on
+ *      [unsigned long] - the frame to wait for
+ *
+ * OUT: N/A
+ */
+void jobw_wait_frame(job_wavefront *, unsigned long);
+
+
+/*
+ * Releases a completed frame, allowing the jobs of the frame two after it (which reuse its
+ * framebuffer) to become ready
+ *
+ * Frames must be released in order
+ *
+ * IN:
+ *      [job_wavefront *] - the job wavefront
+ *      [unsigned long] - the frame to release
+ *
+ * OUT: N/A
+ */
+void jobw_release_frame(job_wavefront *, unsigned long);
+
+
+/*
+ * Signals all workers waiting on the wavefront to quit
+ *
+ * IN:
+ *      [job_wavefront *] - the job wavefront to quit
+ *
+ * OUT: N/A
+ */
+void jobw_quit(job_wavefront *);
+
+
+// -----===[ Frame Barrier Functions ]===-----
+
+/*
+ * Creates a new frame barrier
+ *
+ * IN:
+ *      [unsigned int] - the number of threads that must arrive to pass the barrier
+ *
+ * OUT: [frame_barrier * | NULL] - the newly created barrier
+ *                                 NULL on error
+ */
+frame_barrier *fbar_init(unsigned int);
+
+
+/*
+ * Deletes a frame barrier
+ *
+ * IN:
+ *      [frame_barrier *] - the barrier to delete
+ *
+ * OUT: N/A
+ */
+void fbar_delete(frame_barrier *);
+
+
+/*
+ * Waits at a frame barrier until all threads have arrived
+ *
+ * Spins for up to FRAME_BARRIER_SPIN checks before sleeping
+ * Everything done by each thread before arriving is visible to all threads once passed
+ *
+ * IN:
+ *      [frame_barrier *] - the barrier to wait at
+ *
+ * OUT: [int] - 1 for the last thread to arrive, 0 for all others
+ */
+int fbar_wait(frame_barrier *);
+
+
+/*
+ * Changes the number of threads that must arrive to pass a frame barrier (eg. when fewer
+ * threads were started than it was created for)
+ *
+ * Safe while other threads are waiting at the barrier, so long as no more of them have
+ * arrived than the new number
+ *
+ * IN:
+ *      [frame_barrier *] - the barrier to resize
+ *      [unsigned int] - the number of threads that must arrive to pass the barrier
+ *
+ * OUT: N/A
+ */
+void fbar_resize(frame_barrier *, unsigned int);
+
+
 // -----===[ Job Functions ]===-----
 
 /*
@@ -171,6 +755,8 @@ render_job *job_quit_init(void);
 /*
  * Deletes a render job
  *
+ * Jobs that are part of an arena are left as they are
+ *
  * IN:
  *      [render_job *] - the render job to delete
  *
@@ -178,4 +764,167 @@ render_job *job_quit_init(void);
  */
 void job_delete(render_job *);
 
+
+/*
+ * Fills in the provided jobs as quit jobs
+ *
+ * IN:
+ *      [render_job *] - the jobs to fill in
+ *      [unsigned int] - the number of jobs
+ *
+ * OUT: N/A
+ */
+void job_plan_quit(render_job *, unsigned int);
+
+
+/*
+ * Splits a frame into (at most) the given number of horizontal bands, filling
+ * in the provided jobs
+ *
+ * IN:
+ *      [render_job *] - the jobs to fill in (must have space for the given number of jobs)
+ *      [unsigned int] - the maximum number of jobs
+ *      [unsigned int] - the x dimension of the frame
+ *      [unsigned int] - the y dimension of the frame
+ *
+ * OUT: [unsigned int] - the number of jobs actually filled in
+ */
+unsigned int job_plan_bands(render_job *, unsigned int, unsigned int, unsigned int);
+
+
+/*
+ * Splits a frame into horizontal bands whose boundaries fall on multiples of the given
+ * height (except at the bottom edge), filling in the provided jobs
+ *
+ * Used to keep groups of rows (see `group_fragment` in fragment.h) within a single job
+ *
+ * IN:
+ *      [render_job *] - the jobs to fill in (must have space for the max number of jobs)
+ *      [unsigned int] - the max number of jobs
+ *      [unsigned int] - the x dimension of the frame
+ *      [unsigned int] - the y dimension of the frame
+ *      [unsigned int] - the height that band boundaries are aligned to (non-zero)
+ *
+ * OUT: [unsigned int] - the number of jobs filled in
+ */
+unsigned int job_plan_group_bands(render_job *, unsigned int, unsigned int, unsigned int, unsigned int);
+
+
+/*
+ * Determines the number of tiles (of the given size) needed to cover a frame
+ *
+ * IN:
+ *      [unsigned int] - the x dimension of the frame
+ *      [unsigned int] - the y dimension of the frame
+ *      [unsigned int] - the x dimension of a tile (non-zero)
+ *      [unsigned int] - the y dimension of a tile (non-zero)
+ *
+ * OUT: [unsigned int] - the number of tiles
+ */
+unsigned int job_plan_tile_count(unsigned int, unsigned int, unsigned int, unsigned int);
+
+
+/*
+ * Splits a frame into tiles of the given size (clipped at the frame edges), filling in
+ * the provided jobs in the given traversal order
+ *
+ * IN:
+ *      [render_job *] - the jobs to fill in (must have space for `job_plan_tile_count` jobs)
+ *      [unsigned int] - the x dimension of the frame
+ *      [unsigned int] - the y dimension of the frame
+ *      [unsigned int] - the x dimension of a tile (non-zero)
+ *      [unsigned int] - the y dimension of a tile (non-zero)
+ *      [tile_order] - the order to issue tiles in
+ *
+ * OUT: [unsigned int] - the number of jobs filled in
+ */
+unsigned int job_plan_tiles(render_job *, unsigned int, unsigned int, unsigned int, unsigned int, tile_order);
+
+
+
+// -----===[ Cost Map Functions ]===-----
+
+/*
+ * Creates a new cost map for a frame, with every cell's cost at zero
+ *
+ * IN:
+ *      [unsigned int] - the x dimension of the frame
+ *      [unsigned int] - the y dimension of the frame
+ *      [unsigned int] - the x dimension of each cell (non-zero)
+ *      [unsigned int] - the y dimension of each cell (non-zero)
+ *
+ * OUT: [job_costmap * | NULL] - the newly created cost map
+ *                               NULL on error
+ */
+job_costmap *costmap_init(unsigned int, unsigned int, unsigned int, unsigned int);
+
+
+/*
+ * Deletes a cost map
+ *
+ * IN:
+ *      [job_costmap *] - the cost map to delete
+ *
+ * OUT: N/A
+ */
+void costmap_delete(job_costmap *);
+
+
+/*
+ * Records the time taken by a job, spreading it evenly over the cells the job covers
+ *
+ * The job must cover whole cells
+ *
+ * IN:
+ *      [job_costmap *] - the cost map to record into
+ *      [render_job *] - the job that was completed
+ *      [unsigned long long] - the time (ns) that the job took
+ *
+ * OUT: N/A
+ */
+void costmap_record(job_costmap *, render_job *, unsigned long long);
+
+
+/*
+ * Determines the recorded cost of a job (the total cost of the cells it covers)
+ *
+ * IN:
+ *      [job_costmap *] - the cost map to read from
+ *      [render_job *] - the job to determine the cost of
+ *
+ * OUT: [double] - the cost (ns) of the job
+ */
+double costmap_job_cost(job_costmap *, render_job *);
+
+
+/*
+ * Splits a frame into (at most) the given number of horizontal bands of equal cost, filling in
+ * the provided jobs
+ *
+ * The cost map must have a cell for each row (cell_w equal to the frame width, cell_h of one)
+ * Falls back to bands of equal size if no cost has been recorded
+ *
+ * IN:
+ *      [render_job *] - the jobs to fill in (must have space for the given number of jobs)
+ *      [unsigned int] - the maximum number of jobs
+ *      [job_costmap *] - the cost map of the previous frame
+ *
+ * OUT: [unsigned int] - the number of jobs actually filled in
+ */
+unsigned int job_plan_bands_adaptive(render_job *, unsigned int, job_costmap *);
+
+
+/*
+ * Reorders jobs so that the most expensive (by the cost map) are first, keeping the
+ * existing order between jobs of equal cost
+ *
+ * IN:
+ *      [render_job *] - the jobs to reorder
+ *      [unsigned int] - the number of jobs
+ *      [job_costmap *] - the cost map of the previous frame
+ *
+ * OUT: [int] - 0 on success, -1 on memory error (the jobs are left as they were)
+ */
+int job_plan_sort_cost(render_job *, unsigned int, job_costmap *);
+
 #endif
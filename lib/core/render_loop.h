@@ -0,0 +1,61 @@
+/*
+ * Provides the render loop as a macro, so that it can be instantiated in the same translation
+ * unit as a fragment shader
+ *
+ * The core's own render loop calls `fragment` through the linker, once per pixel, so it can
+ * never be inlined into the loop, nor the loop vectorised around it
+ * Expanding FRAGMENT_RENDER_LOOP() after `fragment` is defined provides `fragment_render_job`,
+ * which the core calls once per job instead (`shaderc -l` does this)
+ */
+
+#ifndef RENDER_LOOP_H
+#define RENDER_LOOP_H
+
+#include "framebuffer.h"
+#include "render_job.h"
+#include "tuple.h"
+#include "fragment.h"
+
+// -----===[ Definitions ]===-----
+
+/*
+ * The row stride of the frame - a constant if the shader was specialised for a resolution
+ * (`shaderc -r`), so that rows are addressed without reading the frame
+ */
+#ifdef FRAG_DIM_X
+#define FRAGMENT_ROW_STRIDE(frame) ((size_t) FRAG_DIM_X)
+#else
+#define FRAGMENT_ROW_STRIDE(frame) ((size_t) (frame)->dimx)
+#endif
+
+
+/*
+ * Defines `fragment_render_job` (see fragment.h), rendering each pixel of the job with
+ * `fragment` (after `row_setup`, if defined), and writing it straight into the frame
+ */
+#define FRAGMENT_RENDER_LOOP()                                                      \
+void fragment_render_job(render_job *job, framebuf *frame)                          \
+{                                                                                   \
+    tup3 active_uv = { 0.0f, 0.0f, 0.0f, 0.0f };                                   \
+                                                                                    \
+    for (unsigned int y = job->y_start; y < job->y_end; y++)                        \
+    {                                                                               \
+        tup3 *row = frame->buf + y * FRAGMENT_ROW_STRIDE(frame);                    \
+                                                                                    \
+        active_uv.y = y;                                                            \
+                                                                                    \
+        if (row_setup != NULL)                                                      \
+        {                                                                           \
+            row_setup(y);                                                           \
+        }                                                                           \
+                                                                                    \
+        for (unsigned int x = job->x_start; x < job->x_end; x++)                    \
+        {                                                                           \
+            active_uv.x = x;                                                        \
+                                                                                    \
+            row[x] = fragment(&active_uv);                                          \
+        }                                                                           \
+    }                                                                               \
+}
+
+#endif
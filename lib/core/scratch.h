@@ -0,0 +1,138 @@
+/*
+ * A scratch arena is a fixed block of memory that is handed out by bumping an offset, and
+ * reclaimed all at once by resetting it
+ *
+ * Each arena belongs to a single thread, so no allocation ever locks - allocating and resetting
+ * are a handful of instructions, and are inlined
+ */
+
+#ifndef SCRATCH_H
+#define SCRATCH_H
+
+#include <stdlib.h>
+
+// -----===[ Definitions ]===-----
+
+// The alignment of every allocation - enough for a tup3
+#define SCRATCH_ALIGN (16)
+
+
+// -----===[ Structures ]===-----
+
+/*
+ * A scratch arena
+ *
+ * size and used are always multiples of SCRATCH_ALIGN
+ *
+ * base [char *] - the memory handed out
+ * size [size_t] - the size of the memory (bytes)
+ * used [size_t] - the offset of the next allocation (bytes)
+ */
+typedef struct scratch_arena {
+    char *base;
+    size_t size;
+    size_t used;
+} scratch_arena;
+
+
+// -----===[ Functions ]===-----
+
+/*
+ * Creates a new, empty scratch arena
+ *
+ * IN:
+ *      [size_t] - the size of the arena (bytes)
+ *
+ * OUT: [scratch_arena * | NULL] - the newly created scratch arena
+ *                                 NULL on memory error
+ */
+scratch_arena *scratch_init(size_t);
+
+
+/*
+ * Deletes a scratch arena, and all memory handed out from it
+ *
+ * IN:
+ *      [scratch_arena *] - the scratch arena to delete
+ *
+ * OUT: N/A
+ */
+void scratch_delete(scratch_arena *);
+
+
+/*
+ * Allocates memory from a scratch arena, aligned to SCRATCH_ALIGN
+ *
+ * The memory is not initialised, and remains valid until the arena is reset (or released
+ * to an earlier mark)
+ *
+ * IN:
+ *      [scratch_arena * | NULL] - the scratch arena to allocate from
+ *      [size_t] - the number of bytes to allocate
+ *
+ * OUT: [void * | NULL] - the allocated memory
+ *                        NULL if the arena is full (or NULL)
+ */
+static inline void *scratch_alloc(scratch_arena *sa, size_t n)
+{
+    if (sa == NULL || n > sa->size - sa->used)
+    {
+        return NULL;
+    }
+
+    void *mem = sa->base + sa->used;
+
+    // Round up to keep the next allocation aligned - the remaining space is always a
+    // multiple of the alignment, so this still fits
+    sa->used += (n + SCRATCH_ALIGN - 1) & ~((size_t) SCRATCH_ALIGN - 1);
+
+    return mem;
+}
+
+
+/*
+ * Marks the current extent of a scratch arena, so that later allocations can be released
+ *
+ * IN:
+ *      [scratch_arena * | NULL] - the scratch arena
+ *
+ * OUT: [size_t] - the mark
+ */
+static inline size_t scratch_mark(scratch_arena *sa)
+{
+    return (sa == NULL) ? 0 : sa->used;
+}
+
+
+/*
+ * Releases all memory allocated from a scratch arena since it was marked
+ *
+ * IN:
+ *      [scratch_arena * | NULL] - the scratch arena
+ *      [size_t] - the mark to release to (see scratch_mark)
+ *
+ * OUT: N/A
+ */
+static inline void scratch_release(scratch_arena *sa, size_t mark)
+{
+    if (sa != NULL && mark < sa->used)
+    {
+        sa->used = mark;
+    }
+}
+
+
+/*
+ * Releases all memory allocated from a scratch arena
+ *
+ * IN:
+ *      [scratch_arena * | NULL] - the scratch arena
+ *
+ * OUT: N/A
+ */
+static inline void scratch_reset(scratch_arena *sa)
+{
+    scratch_release(sa, 0);
+}
+
+#endif
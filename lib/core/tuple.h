@@ -23,9 +23,12 @@
 
 /*
  * A 3-dimensional tuple
+ *
+ * Aligned to 16 bytes, so that each tuple fits one SIMD register and never straddles
+ * cache lines
  */
 typedef struct tup3 {
-    float x;
+    _Alignas(16) float x;
     float y;
     float z;
     float w;
@@ -0,0 +1,325 @@
+/*
+ * A header-only variant of the tuple API (see tuple.h), where every function is static inline
+ * and takes its tuples by value
+ *
+ * Each function mirrors the equivalent tuple function, with a `v` suffix (eg. `add_t3v` for
+ * `add_t3`), and compiles down to a few instructions at the point of use rather than a call
+ * The out-of-line functions in tuple.c remain, and are unaffected
+ *
+ * If TUPLE_INLINE is defined before this header is included, the pointer-based tuple functions
+ * are also redirected here (eg. `add_t3(&a, &b)` becomes `add_t3v(a, b)`), so that existing
+ * shaders are inlined without changes - `shaderc` does this by default
+ * Their addresses can still be taken, and refer to the out-of-line functions
+ */
+
+#ifndef TUPLE_INLINE_H
+#define TUPLE_INLINE_H
+
+#include <math.h>
+#include "tuple.h"
+
+// -----===[ Functions ]===-----
+
+// < Tuple Creation >
+
+/*
+ * Creates a new arbitrary tuple with the given components
+ *
+ * IN:
+ *      [float] - the x component
+ *      [float] - the y component
+ *      [float] - the z component
+ *      [float] - the w component
+ *
+ * OUT: [tup3] - a tuple with those components
+ */
+static inline tup3 tuple3v(float x, float y, float z, float w)
+{
+    tup3 res = { x, y, z, w };
+
+    return res;
+}
+
+
+/*
+ * Creates a new point tuple with the given coordinates
+ *
+ * IN:
+ *      [float] - the x coordinate
+ *      [float] - the y coordinate
+ *      [float] - the z coordinate
+ *
+ * OUT: [tup3] - a tuple with those coordinates
+ */
+static inline tup3 point3v(float x, float y, float z)
+{
+    tup3 res = { x, y, z, 1.0f };
+
+    return res;
+}
+
+
+/*
+ * Creates a new vector tuple with the given components
+ *
+ * IN:
+ *      [float] - the x component
+ *      [float] - the y component
+ *      [float] - the z component
+ *
+ * OUT: [tup3] - a tuple with those components
+ */
+static inline tup3 vec3v(float x, float y, float z)
+{
+    tup3 res = { x, y, z, 0.0f };
+
+    return res;
+}
+
+
+/*
+ * Creates a new XYZ colour tuple
+ *
+ * IN:
+ *      [float [0, 1]] - the x colour channel (red)
+ *      [float [0, 1]] - the y colour channel (green)
+ *      [float [0, 1]] - the z colour channel (blue)
+ *
+ * OUT: [tup3] - a tuple representing that colour
+ */
+static inline tup3 col_xyzv(float x, float y, float z)
+{
+    tup3 res = { x, y, z, 1.0f };
+
+    return res;
+}
+
+
+// < Tuple Operations >
+
+/*
+ * Checks tuple equality
+ *
+ * IN:
+ *      [tup3] - the first tuple to compare
+ *      [tup3] - the second tuple to compare
+ *
+ * OUT: [int] - 0: they differ in at least one component
+ *              1: they have the same components
+ */
+static inline int eq_t3v(tup3 a, tup3 b)
+{
+    return (fabsf(a.x - b.x) < TUP_EPSILON) &
+           (fabsf(a.y - b.y) < TUP_EPSILON) &
+           (fabsf(a.z - b.z) < TUP_EPSILON) &
+           (fabsf(a.w - b.w) < TUP_EPSILON);
+}
+
+
+/*
+ * Adds two tuples component-wise
+ *
+ * IN:
+ *      [tup3] - the first tuple to add
+ *      [tup3] - the second tuple to add
+ *
+ * OUT: [tup3] - the result of the addition
+ */
+static inline tup3 add_t3v(tup3 a, tup3 b)
+{
+    tup3 res = { a.x + b.x, a.y + b.y, a.z + b.z, a.w + b.w };
+
+    return res;
+}
+
+
+/*
+ * Subtracts one tuple from another component-wise
+ *
+ * IN:
+ *      [tup3] - the tuple to subtract FROM
+ *      [tup3] - the tuple to subtract
+ *
+ * OUT: [tup3] - the result of the subtraction
+ */
+static inline tup3 sub_t3v(tup3 a, tup3 b)
+{
+    tup3 res = { a.x - b.x, a.y - b.y, a.z - b.z, a.w - b.w };
+
+    return res;
+}
+
+
+/*
+ * Negates a given tuple, including the w-component
+ *
+ * IN:
+ *      [tup3] - the tuple to negate
+ *
+ * OUT: [tup3] - the negated tuple
+ */
+static inline tup3 neg_t3v(tup3 a)
+{
+    tup3 res = { -a.x, -a.y, -a.z, -a.w };
+
+    return res;
+}
+
+
+/*
+ * Performs scalar multiplication of a tuple
+ *
+ * IN:
+ *      [tup3] - the tuple to scale
+ *      [float] - the scaling factor
+ *
+ * OUT: [tup3] - the scaled tuple
+ */
+static inline tup3 mul_t3v(tup3 a, float s)
+{
+    tup3 res = { a.x * s, a.y * s, a.z * s, a.w * s };
+
+    return res;
+}
+
+
+/*
+ * Performs component-wise multiplication of tuples
+ *
+ * IN:
+ *      [tup3] - the first tuple
+ *      [tup3] - the second tuple
+ *
+ * OUT: [tup3] - the result
+ */
+static inline tup3 hadamard_t3v(tup3 a, tup3 b)
+{
+    tup3 res = { a.x * b.x, a.y * b.y, a.z * b.z, a.w * b.w };
+
+    return res;
+}
+
+
+/*
+ * Performs scalar division of a tuple
+ *
+ * IN:
+ *      [tup3] - the tuple to scale
+ *      [float] - the scaling factor
+ *
+ * OUT: [tup3] - the scaled tuple
+ *               all zero if the factor is (near) zero
+ */
+static inline tup3 div_t3v(tup3 a, float s)
+{
+    // Catch divide by zero
+    if (fabsf(s) < TUP_EPSILON)
+    {
+        return tuple3v(0.0f, 0.0f, 0.0f, 0.0f);
+    }
+
+    tup3 res = { a.x / s, a.y / s, a.z / s, a.w / s };
+
+    return res;
+}
+
+
+/*
+ * Determines the magnitude of a tuple
+ *
+ * IN:
+ *      [tup3] - the tuple to calculate the magnitude for
+ *
+ * OUT: [float] - the magnitude of the tuple
+ */
+static inline float mag_t3v(tup3 a)
+{
+    return sqrtf(a.x * a.x + a.y * a.y + a.z * a.z);
+}
+
+
+/*
+ * Normalises a tuple
+ *
+ * IN:
+ *      [tup3] - the tuple to normalise
+ *
+ * OUT: [tup3] - the normalised tuple
+ *               all zero if the magnitude is (near) zero
+ */
+static inline tup3 norm_t3v(tup3 a)
+{
+    float mag = mag_t3v(a);
+
+    if (fabsf(mag) < TUP_EPSILON)
+    {
+        return tuple3v(0.0f, 0.0f, 0.0f, 0.0f);
+    }
+
+    tup3 res = { a.x / mag, a.y / mag, a.z / mag, a.w };
+
+    return res;
+}
+
+
+/*
+ * Calculates the dot product of two tuples
+ *
+ * IN:
+ *      [tup3] - the first tuple to dot
+ *      [tup3] - the second tuple to dot
+ *
+ * OUT: [float] - the dot product of the two tuples
+ */
+static inline float dot_t3v(tup3 a, tup3 b)
+{
+    return a.x * b.x + a.y * b.y + a.z * b.z + a.w * b.w;
+}
+
+
+/*
+ * Calculates the cross product of two tuples
+ *
+ * IN:
+ *      [tup3] - the first tuple to cross
+ *      [tup3] - the second tuple to cross
+ *
+ * OUT: [tup3] - the cross product of the two tuples
+ */
+static inline tup3 cross_t3v(tup3 a, tup3 b)
+{
+    tup3 res = {
+        a.y * b.z - a.z * b.y,
+        a.z * b.x - a.x * b.z,
+        a.x * b.y - a.y * b.x,
+        0.0f
+    };
+
+    return res;
+}
+
+
+// < Redirection >
+
+#ifdef TUPLE_INLINE
+
+#define tuple3(x, y, z, w) tuple3v((x), (y), (z), (w))
+#define point3(x, y, z) point3v((x), (y), (z))
+#define vec3(x, y, z) vec3v((x), (y), (z))
+#define col_xyz(x, y, z) col_xyzv((x), (y), (z))
+
+#define eq_t3(a, b) eq_t3v(*(a), *(b))
+#define add_t3(a, b) add_t3v(*(a), *(b))
+#define sub_t3(a, b) sub_t3v(*(a), *(b))
+#define neg_t3(a) neg_t3v(*(a))
+#define mul_t3(a, s) mul_t3v(*(a), (s))
+#define hadamard_t3(a, b) hadamard_t3v(*(a), *(b))
+#define div_t3(a, s) div_t3v(*(a), (s))
+#define mag_t3(a) mag_t3v(*(a))
+#define norm_t3(a) norm_t3v(*(a))
+#define dot_t3(a, b) dot_t3v(*(a), *(b))
+#define cross_t3(a, b) cross_t3v(*(a), *(b))
+
+#endif
+
+#endif
@@ -0,0 +1,484 @@
+/*
+ * A tuple packet holds eight tuples in structure-of-arrays form, one tuple per lane, so that
+ * each operation is applied to all eight tuples at once
+ *
+ * Lanes use GCC vector extensions, so are lowered to whichever SIMD instructions the target
+ * provides (eg. two SSE or NEON registers, or one AVX register per component)
+ * Lane masks follow vector comparisons - a lane is active if all bits are set (-1), and
+ * inactive if zero
+ *
+ * Every operation mirrors the equivalent tuple operation (see tuple.h), lane by lane
+ */
+
+#ifndef TUPLE_X8_H
+#define TUPLE_X8_H
+
+#include <math.h>
+#include "tuple.h"
+
+// -----===[ Definitions ]===-----
+
+// The number of tuples in a packet
+#define TUP_LANES (8)
+
+
+// -----===[ Structures ]===-----
+
+/*
+ * Eight floats, or eight lane masks
+ */
+typedef float f32x8 __attribute__((vector_size(TUP_LANES * sizeof(float))));
+typedef int mask8 __attribute__((vector_size(TUP_LANES * sizeof(int))));
+
+// Lanes are wider than the baseline SIMD registers, so GCC warns that passing or returning them
+// by value changes the ABI - they only ever are to and from inline functions, so this does not
+// matter here
+// GCC reports the warning once the whole translation unit has been read, so it is ignored from
+// here on, rather than only around these functions
+#pragma GCC diagnostic ignored "-Wpsabi"
+
+
+/*
+ * Eight 3-dimensional tuples
+ */
+typedef struct tup3x8 {
+    f32x8 x;
+    f32x8 y;
+    f32x8 z;
+    f32x8 w;
+} tup3x8;
+
+
+// -----===[ Functions ]===-----
+
+// < Lane Creation >
+
+/*
+ * Creates a lane vector with the same value in every lane
+ *
+ * IN:
+ *      [float] - the value
+ *
+ * OUT: [f32x8] - the value in each lane
+ */
+static inline f32x8 splat_x8(float v)
+{
+    return (f32x8) { v, v, v, v, v, v, v, v };
+}
+
+
+/*
+ * Creates a lane mask with the first lanes active
+ *
+ * IN:
+ *      [unsigned int] - the number of active lanes
+ *
+ * OUT: [mask8] - the mask
+ */
+static inline mask8 mask_first_x8(unsigned int n)
+{
+    const mask8 lane = { 0, 1, 2, 3, 4, 5, 6, 7 };
+
+    return lane < (int) n;
+}
+
+
+/*
+ * Chooses between the lanes of two lane vectors
+ *
+ * IN:
+ *      [mask8] - the lanes to take from the first vector
+ *      [f32x8] - the vector for active lanes
+ *      [f32x8] - the vector for inactive lanes
+ *
+ * OUT: [f32x8] - the merged vector
+ */
+static inline f32x8 blend_x8(mask8 m, f32x8 a, f32x8 b)
+{
+    // Vector casts reinterpret the bits of each lane
+    return (f32x8) (((mask8) a & m) | ((mask8) b & ~m));
+}
+
+
+// < Tuple Creation >
+
+/*
+ * Creates a packet with the same tuple in every lane
+ *
+ * IN:
+ *      [tup3 *] - the tuple
+ *
+ * OUT: [tup3x8] - a packet of that tuple
+ */
+static inline tup3x8 splat_t3x8(tup3 *a)
+{
+    tup3x8 res;
+
+    res.x = splat_x8(a->x);
+    res.y = splat_x8(a->y);
+    res.z = splat_x8(a->z);
+    res.w = splat_x8(a->w);
+
+    return res;
+}
+
+
+/*
+ * Creates a packet of point tuples with the given coordinates
+ *
+ * IN:
+ *      [f32x8] - the x coordinates
+ *      [f32x8] - the y coordinates
+ *      [f32x8] - the z coordinates
+ *
+ * OUT: [tup3x8] - a packet with those coordinates
+ */
+static inline tup3x8 point3x8(f32x8 x, f32x8 y, f32x8 z)
+{
+    tup3x8 res = { x, y, z, splat_x8(1.0f) };
+
+    return res;
+}
+
+
+/*
+ * Creates a packet of vector tuples with the given components
+ *
+ * IN:
+ *      [f32x8] - the x components
+ *      [f32x8] - the y components
+ *      [f32x8] - the z components
+ *
+ * OUT: [tup3x8] - a packet with those components
+ */
+static inline tup3x8 vec3x8(f32x8 x, f32x8 y, f32x8 z)
+{
+    tup3x8 res = { x, y, z, splat_x8(0.0f) };
+
+    return res;
+}
+
+
+/*
+ * Creates a packet of XYZ colour tuples
+ *
+ * IN:
+ *      [f32x8 [0, 1]] - the x colour channels (red)
+ *      [f32x8 [0, 1]] - the y colour channels (green)
+ *      [f32x8 [0, 1]] - the z colour channels (blue)
+ *
+ * OUT: [tup3x8] - a packet representing those colours
+ */
+static inline tup3x8 col_xyz_x8(f32x8 x, f32x8 y, f32x8 z)
+{
+    tup3x8 res = { x, y, z, splat_x8(1.0f) };
+
+    return res;
+}
+
+
+// < Packing >
+
+/*
+ * Loads consecutive tuples into the lanes of a packet
+ *
+ * Lanes past the given count repeat the last tuple
+ *
+ * IN:
+ *      [const tup3 *] - the tuples to load
+ *      [unsigned int [1, TUP_LANES]] - the number of tuples to load
+ *
+ * OUT: [tup3x8] - a packet of those tuples
+ */
+static inline tup3x8 load_t3x8(const tup3 *src, unsigned int n)
+{
+    tup3x8 res;
+
+    for (unsigned int i = 0; i < TUP_LANES; i++)
+    {
+        const tup3 *t = src + (i < n ? i : n - 1);
+
+        res.x[i] = t->x;
+        res.y[i] = t->y;
+        res.z[i] = t->z;
+        res.w[i] = t->w;
+    }
+
+    return res;
+}
+
+
+/*
+ * Stores the first lanes of a packet to consecutive tuples
+ *
+ * IN:
+ *      [tup3 *] - where to store the tuples
+ *      [tup3x8 *] - the packet to store
+ *      [unsigned int [0, TUP_LANES]] - the number of lanes to store
+ *
+ * OUT: N/A
+ */
+static inline void store_t3x8(tup3 *dest, tup3x8 *a, unsigned int n)
+{
+    for (unsigned int i = 0; i < n; i++)
+    {
+        dest[i].x = a->x[i];
+        dest[i].y = a->y[i];
+        dest[i].z = a->z[i];
+        dest[i].w = a->w[i];
+    }
+}
+
+
+/*
+ * Chooses between the lanes of two packets
+ *
+ * IN:
+ *      [mask8] - the lanes to take from the first packet
+ *      [tup3x8 *] - the packet for active lanes
+ *      [tup3x8 *] - the packet for inactive lanes
+ *
+ * OUT: [tup3x8] - the merged packet
+ */
+static inline tup3x8 select_t3x8(mask8 m, tup3x8 *a, tup3x8 *b)
+{
+    tup3x8 res;
+
+    res.x = blend_x8(m, a->x, b->x);
+    res.y = blend_x8(m, a->y, b->y);
+    res.z = blend_x8(m, a->z, b->z);
+    res.w = blend_x8(m, a->w, b->w);
+
+    return res;
+}
+
+
+// < Tuple Operations >
+
+/*
+ * Checks tuple equality, lane by lane
+ *
+ * IN:
+ *      [tup3x8 *] - the first packet to compare
+ *      [tup3x8 *] - the second packet to compare
+ *
+ * OUT: [mask8] - active for lanes with the same components
+ */
+static inline mask8 eq_t3x8(tup3x8 *a, tup3x8 *b)
+{
+    f32x8 eps = splat_x8(TUP_EPSILON);
+    f32x8 dx = a->x - b->x;
+    f32x8 dy = a->y - b->y;
+    f32x8 dz = a->z - b->z;
+    f32x8 dw = a->w - b->w;
+
+    return ((dx < eps) & (dx > -eps)) &
+           ((dy < eps) & (dy > -eps)) &
+           ((dz < eps) & (dz > -eps)) &
+           ((dw < eps) & (dw > -eps));
+}
+
+
+/*
+ * Adds two packets component-wise
+ *
+ * IN:
+ *      [tup3x8 *] - the first packet to add
+ *      [tup3x8 *] - the second packet to add
+ *
+ * OUT: [tup3x8] - the result of the addition
+ */
+static inline tup3x8 add_t3x8(tup3x8 *a, tup3x8 *b)
+{
+    tup3x8 res = { a->x + b->x, a->y + b->y, a->z + b->z, a->w + b->w };
+
+    return res;
+}
+
+
+/*
+ * Subtracts one packet from another component-wise
+ *
+ * IN:
+ *      [tup3x8 *] - the packet to subtract FROM
+ *      [tup3x8 *] - the packet to subtract
+ *
+ * OUT: [tup3x8] - the result of the subtraction
+ */
+static inline tup3x8 sub_t3x8(tup3x8 *a, tup3x8 *b)
+{
+    tup3x8 res = { a->x - b->x, a->y - b->y, a->z - b->z, a->w - b->w };
+
+    return res;
+}
+
+
+/*
+ * Negates a packet, including the w-components
+ *
+ * IN:
+ *      [tup3x8 *] - the packet to negate
+ *
+ * OUT: [tup3x8] - the negated packet
+ */
+static inline tup3x8 neg_t3x8(tup3x8 *a)
+{
+    tup3x8 res = { -a->x, -a->y, -a->z, -a->w };
+
+    return res;
+}
+
+
+/*
+ * Performs scalar multiplication of a packet, with a scaling factor per lane
+ *
+ * IN:
+ *      [tup3x8 *] - the packet to scale
+ *      [f32x8] - the scaling factors
+ *
+ * OUT: [tup3x8] - the scaled packet
+ */
+static inline tup3x8 mul_t3x8(tup3x8 *a, f32x8 s)
+{
+    tup3x8 res = { a->x * s, a->y * s, a->z * s, a->w * s };
+
+    return res;
+}
+
+
+/*
+ * Performs component-wise multiplication of packets
+ *
+ * IN:
+ *      [tup3x8 *] - the first packet
+ *      [tup3x8 *] - the second packet
+ *
+ * OUT: [tup3x8] - the result
+ */
+static inline tup3x8 hadamard_t3x8(tup3x8 *a, tup3x8 *b)
+{
+    tup3x8 res = { a->x * b->x, a->y * b->y, a->z * b->z, a->w * b->w };
+
+    return res;
+}
+
+
+/*
+ * Performs scalar division of a packet, with a scaling factor per lane
+ *
+ * Lanes with a (near) zero factor are set to zero
+ *
+ * IN:
+ *      [tup3x8 *] - the packet to scale
+ *      [f32x8] - the scaling factors
+ *
+ * OUT: [tup3x8] - the scaled packet
+ */
+static inline tup3x8 div_t3x8(tup3x8 *a, f32x8 s)
+{
+    f32x8 eps = splat_x8(TUP_EPSILON);
+    mask8 valid = (s >= eps) | (s <= -eps);
+    f32x8 zero = splat_x8(0.0f);
+
+    // Divide by one in invalid lanes, then clear them
+    s = blend_x8(valid, s, splat_x8(1.0f));
+
+    tup3x8 res = {
+        blend_x8(valid, a->x / s, zero),
+        blend_x8(valid, a->y / s, zero),
+        blend_x8(valid, a->z / s, zero),
+        blend_x8(valid, a->w / s, zero)
+    };
+
+    return res;
+}
+
+
+/*
+ * Determines the magnitude of each tuple in a packet
+ *
+ * IN:
+ *      [tup3x8 *] - the packet to calculate the magnitudes for
+ *
+ * OUT: [f32x8] - the magnitude of each tuple
+ */
+static inline f32x8 mag_t3x8(tup3x8 *a)
+{
+    f32x8 mag = a->x * a->x + a->y * a->y + a->z * a->z;
+
+    // There is no vector extension square root - this loop is vectorised instead
+    for (unsigned int i = 0; i < TUP_LANES; i++)
+    {
+        mag[i] = sqrtf(mag[i]);
+    }
+
+    return mag;
+}
+
+
+/*
+ * Normalises each tuple in a packet
+ *
+ * Lanes with a (near) zero magnitude are set to zero
+ *
+ * IN:
+ *      [tup3x8 *] - the packet to normalise
+ *
+ * OUT: [tup3x8] - the normalised packet
+ */
+static inline tup3x8 norm_t3x8(tup3x8 *a)
+{
+    f32x8 mag = mag_t3x8(a);
+    mask8 valid = mag >= splat_x8(TUP_EPSILON);
+    f32x8 zero = splat_x8(0.0f);
+
+    mag = blend_x8(valid, mag, splat_x8(1.0f));
+
+    tup3x8 res = {
+        blend_x8(valid, a->x / mag, zero),
+        blend_x8(valid, a->y / mag, zero),
+        blend_x8(valid, a->z / mag, zero),
+        blend_x8(valid, a->w, zero)
+    };
+
+    return res;
+}
+
+
+/*
+ * Calculates the dot product of two packets, lane by lane
+ *
+ * IN:
+ *      [tup3x8 *] - the first packet to dot
+ *      [tup3x8 *] - the second packet to dot
+ *
+ * OUT: [f32x8] - the dot product of each pair of tuples
+ */
+static inline f32x8 dot_t3x8(tup3x8 *a, tup3x8 *b)
+{
+    return a->x * b->x + a->y * b->y + a->z * b->z + a->w * b->w;
+}
+
+
+/*
+ * Calculates the cross product of two packets, lane by lane
+ *
+ * IN:
+ *      [tup3x8 *] - the first packet to cross
+ *      [tup3x8 *] - the second packet to cross
+ *
+ * OUT: [tup3x8] - the cross product of each pair of tuples
+ */
+static inline tup3x8 cross_t3x8(tup3x8 *a, tup3x8 *b)
+{
+    tup3x8 res = {
+        a->y * b->z - a->z * b->y,
+        a->z * b->x - a->x * b->z,
+        a->x * b->y - a->y * b->x,
+        splat_x8(0.0f)
+    };
+
+    return res;
+}
+
+#endif
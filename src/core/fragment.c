@@ -1,9 +1,14 @@
+// For thread affinity
+#define _GNU_SOURCE
+
 #include "core/fragment.h"
 
+#include <sched.h>
+
 
 // -----===[ Globals ]===-----
 
-framebuf *render_frame = NULL;
+static framebuf *render_frame = NULL;
 
 unsigned int n_threads = 4;
 
@@ -11,18 +16,104 @@ unsigned int n_jobs = 8;
 
 unsigned int n_frames = 1;
 
+job_sched sched_mode = JOB_SCHED_QUEUE;
+
+frame_sync sync_mode = FRAME_SYNC_SIGNAL;
+
+unsigned int tile_w = 0;
+unsigned int tile_h = 0;
+
+tile_order tile_traversal = TILE_ORDER_ROW;
+
+int adaptive_jobs = 0;
+
+int pin_threads = 0;
+
+size_t scratch_size = 64 * 1024;
+
+unsigned int group_w = 0;
+unsigned int group_h = 0;
+
+int swap_backbuf = 0;
+
+unsigned int pipeline_depth = 0;
+unsigned int n_writers = 1;
+
+sort_pass frame_sort = { 0, SORT_AXIS_ROWS, 0, NULL };
+
+int stage_backbuf = 0;
+unsigned int stage_halo = 0;
+fb_address stage_address = FB_ADDR_CLAMP;
+unsigned int stage_frames = 1;
+
+fb_format backbuf_format = FB_FORMAT_TUP3;
+fb_layout backbuf_layout = FB_LAYOUT_LINEAR;
+
+unsigned int history_frames = 1;
+
+// The jobs making up each frame, when they are passed through the job queue, followed
+// by a quit job for each thread - built once, and reused every frame
+static render_job *queue_plan = NULL;
+static unsigned int queue_plan_n = 0;
+static render_job *queue_quit = NULL;
+
+// The number of bands that frames are split into
+static unsigned int plan_max_jobs = 0;
+
+// The group dimensions that jobs are currently aligned to
+static unsigned int planned_group_w = 0;
+static unsigned int planned_group_h = 0;
+
+// The cost of each region of the previous frame, when adapting jobs to it
+static job_costmap *costmap = NULL;
+
+// The lanes sorted by each job of a sort pass, and whether jobs currently belong to one
+static render_job *pass_plan = NULL;
+static int pass_active = 0;
+
+// The number of frames that jobs are currently advancing at once (see `stage_frames`)
+static unsigned int block_frames = 1;
+
+// The untouched framebuffers that threads copy their home regions into, when pinned,
+// and the barrier that the main thread waits at until this is done
+static framebuf *home_frame = NULL;
+static framebuf *home_backbuf = NULL;
+static frame_barrier *home_barrier = NULL;
+
+// The output stage that frames are handed to, when pipelined
+static frame_writer *writer = NULL;
+
+// The framebuffer that each frame is rendered into, when rendering a wavefront - frames take
+// turns between the render frame and a spare, unless they are handed over to be saved
+static framebuf **wave_frames = NULL;
+static framebuf *wave_spare = NULL;
+
 
 // -----===[ Global Uniforms ]===-----
 
 framebuf *BACKBUF = NULL;
 
+framebuf **backbuf_history = NULL;
+unsigned int backbuf_history_head = 0;
+
 unsigned long FRAME_COUNT = 0;
 
 unsigned long long CLOCK_NS = 0;
-struct timespec prev_t;
+static struct timespec prev_t;
 
 tup3 FRAME_DIM = { 0.0, 0.0, 0.0, 0.0 };
 
+_Thread_local unsigned int WORKER_ID = 0;
+_Thread_local scratch_arena *WORKER_SCRATCH = NULL;
+_Thread_local staged_region STAGED = { NULL, 0, 0, 0, 0 };
+
+// The number of pixels that the staging buffer of the thread can hold
+static _Thread_local size_t staged_capacity = 0;
+
+// The buffer that each frame of a block is rendered into, before it is staged for the next
+static _Thread_local tup3 *step_buf = NULL;
+static _Thread_local size_t step_capacity = 0;
+
 float CONST_RAND = 0.0;
 
 
@@ -53,6 +144,37 @@ void create_render_frame(unsigned int dimx, unsigned int dimy)
 
             exit(1);
         }
+
+        // The frames before BACKBUF, if the shader reads any
+        if (history_frames > 1)
+        {
+            backbuf_history = calloc(history_frames - 1, sizeof(framebuf *));
+
+            unsigned int n_history = 0;
+
+            while (backbuf_history != NULL && n_history < history_frames - 1
+                   && (backbuf_history[n_history] = framebuf_init(dimx, dimy)) != NULL)
+            {
+                n_history++;
+            }
+
+            if (backbuf_history == NULL || n_history < history_frames - 1)
+            {
+                for (unsigned int i = 0; i < n_history; i++)
+                {
+                    framebuf_delete(backbuf_history[i]);
+                }
+
+                free(backbuf_history);
+                framebuf_delete(render_frame);
+                framebuf_delete(BACKBUF);
+
+                fprintf(stderr, "[ ERROR ] : Not enough memory to keep %u frames of size %d x %d\n",
+                        history_frames, dimx, dimy);
+
+                exit(1);
+            }
+        }
     }
     else
     {
@@ -63,218 +185,1440 @@ void create_render_frame(unsigned int dimx, unsigned int dimy)
 }
 
 
-// -----===[ Internal Functions ]===-----
+// -----===[ Internal Structures ]===-----
 
-void *fragment_thread_main(void *args)
-{
+/*
+ * The arguments given to each thread
+ *
+ * jq [job_queue * | NULL] - the job queue to dequeue from (if not using a dispenser)
+ * jd [job_dispenser * | NULL] - the job dispenser to claim from (if not using a queue)
+ * jw [job_wavefront * | NULL] - the job wavefront to claim from (if rendering a wavefront)
+ * id [unsigned int] - the index of the thread (and its deque, if work stealing)
+ */
+typedef struct worker_args {
     job_queue *jq;
-    render_job *job;
-    int quit = 0;
-    tup3 active_uv = vec3_zero;
+    job_dispenser *jd;
+    job_wavefront *jw;
+    unsigned int id;
+} worker_args;
 
-    jq = (job_queue *)args;
 
-    // Repeatedly try to acquire a render job
-    while (!quit)
+// -----===[ Internal Functions ]===-----
+
+/*
+ * Grows a thread's buffer to hold (at least) the given number of pixels
+ */
+static inline tup3 *grow_buffer(tup3 *buf, size_t *capacity, size_t n)
+{
+    if (n > *capacity)
     {
-        job = jobq_dequeue(jq);
+        tup3 *grown = realloc(buf, sizeof(tup3) * n);
 
-        if (job->quit)
+        if (grown == NULL)
         {
-            quit = 1;
+            fputs("[ ERROR ] : Not enough memory to stage BACKBUF\n", stderr);
+
+            exit(1);
         }
-        else
+
+        buf = grown;
+        *capacity = n;
+    }
+
+    return buf;
+}
+
+
+/*
+ * Copies the job's region of BACKBUF (grown by the given halo) into the thread's staging buffer,
+ * from the given framebuffer (BACKBUF itself, or the previous frame when rendering a wavefront)
+ */
+static inline void stage_region(render_job *job, unsigned int halo, framebuf *src)
+{
+    unsigned int w = job->x_end - job->x_start + 2 * halo;
+    unsigned int h = job->y_end - job->y_start + 2 * halo;
+
+    // Keep the buffer at the size of the largest job seen so far
+    STAGED.buf = grow_buffer(STAGED.buf, &staged_capacity, (size_t) w * h);
+
+    STAGED.x0 = (int) job->x_start - (int) halo;
+    STAGED.y0 = (int) job->y_start - (int) halo;
+    STAGED.w = w;
+    STAGED.h = h;
+
+    framebuf_gather_rect(src, STAGED.x0, STAGED.y0, w, h, stage_address, STAGED.buf);
+}
+
+
+/*
+ * Renders the job's region of every frame of the block but the last, each grown by the halo
+ * that the frames after it read, staging each in turn - leaving the last frame's input staged
+ *
+ * Pixels of each region outside of the frame are copied from the pixels `stage_address` maps
+ * them to, as when staging BACKBUF - which lie within the region, as it fits within the frame
+ */
+static inline void advance_region(render_job *job)
+{
+    tup3 active_uv = vec3_zero;
+    int dimx = render_frame->dimx;
+    int dimy = render_frame->dimy;
+
+    for (unsigned int step = 1; step < block_frames; step++)
+    {
+        unsigned int halo = stage_halo * (block_frames - step);
+        staged_region out;
+
+        out.x0 = (int) job->x_start - (int) halo;
+        out.y0 = (int) job->y_start - (int) halo;
+        out.w = job->x_end - job->x_start + 2 * halo;
+        out.h = job->y_end - job->y_start + 2 * halo;
+        out.buf = step_buf = grow_buffer(step_buf, &step_capacity, (size_t) out.w * out.h);
+
+        // Render the part of the region within the frame
+        int x_start = (out.x0 < 0) ? 0 : out.x0;
+        int x_end = (out.x0 + (int) out.w > dimx) ? dimx : out.x0 + (int) out.w;
+        int y_start = (out.y0 < 0) ? 0 : out.y0;
+        int y_end = (out.y0 + (int) out.h > dimy) ? dimy : out.y0 + (int) out.h;
+
+        for (int y = y_start; y < y_end; y++)
         {
-            for (unsigned int y = job->y_start; y < job->y_end; y++)
+            tup3 *row = out.buf + (size_t) (y - out.y0) * out.w;
+
+            if (row_setup != NULL)
             {
-                for (unsigned int x = job->x_start; x < job->x_end; x++)
-                {
-                    active_uv.x = x;
-                    active_uv.y = y;
+                row_setup(y);
+            }
 
-                    tup3 frag_col = fragment(&active_uv);
+            for (int x = x_start; x < x_end; x++)
+            {
+                active_uv.x = x;
+                active_uv.y = y;
+
+                row[x - out.x0] = fragment(&active_uv);
+            }
+        }
+
+        // Then map the rest back into it
+        for (unsigned int r = 0; r < out.h; r++)
+        {
+            int y = out.y0 + (int) r;
+            tup3 *src_row = out.buf + (size_t) (fb_addr(y, dimy, stage_address) - out.y0) * out.w;
+
+            for (unsigned int c = 0; c < out.w; c++)
+            {
+                int x = out.x0 + (int) c;
 
-                    framebuf_write(render_frame, x, y, &frag_col);
+                if (y < y_start || y >= y_end || x < x_start || x >= x_end)
+                {
+                    out.buf[c + (size_t) r * out.w] = src_row[fb_addr(x, dimx, stage_address) - out.x0];
                 }
             }
         }
 
-        job_delete(job);
+        // The frame just rendered is read by the next, and its input buffer is reused
+        step_buf = STAGED.buf;
+        STAGED = out;
 
-        // Report the completion of the job
-        jobq_report_complete(jq);
-    }
+        size_t capacity = step_capacity;
 
-    return NULL;
+        step_capacity = staged_capacity;
+        staged_capacity = capacity;
+    }
 }
 
 
-int fragment_main(job_queue *jq)
+/*
+ * Renders a job's region of a frame into the given framebuffer, staging BACKBUF (if needed)
+ * from the given framebuffer
+ */
+static inline void render_region(render_job *job, framebuf *out, framebuf *src)
 {
-    // Update CLOCK_NS uniform
-    unsigned long long diff_s = prev_t.tv_sec;
-    unsigned long long diff_ns = prev_t.tv_nsec;
+    tup3 active_uv = vec3_zero;
+    struct timespec start_t, end_t;
 
-    clock_gettime(CLOCK_MONOTONIC, &prev_t);
+    // Scratch memory only lasts for a single job
+    scratch_reset(WORKER_SCRATCH);
 
-    diff_s = prev_t.tv_sec - diff_s;
-    diff_ns = prev_t.tv_nsec - diff_ns;
+    if (costmap != NULL)
+    {
+        clock_gettime(CLOCK_MONOTONIC, &start_t);
+    }
 
-    CLOCK_NS += diff_ns + (diff_s * 1e9);
+    if (stage_backbuf)
+    {
+        // A block of frames starts from a wider region, as each frame shrinks it by the halo
+        stage_region(job, stage_halo * block_frames, src);
+
+        if (block_frames > 1)
+        {
+            advance_region(job);
+        }
+    }
 
-    // Enqueue all render jobs
-    // Compute the size of each job (as a horizontal slice of the frame)
-    unsigned int job_xsize = render_frame->dimx;
+    if (group_fragment != NULL)
+    {
+        // Jobs are aligned to groups, so only the groups at the frame edges are clipped
+        unsigned int gw = group_w ? group_w : 1;
+        unsigned int gh = group_h ? group_h : 1;
 
-    // Take the ceiling of the division
-    unsigned int job_ysize = render_frame->dimy / n_jobs + (render_frame->dimy % n_jobs != 0);
+        for (unsigned int y = job->y_start; y < job->y_end; y += gh)
+        {
+            unsigned int h = (job->y_end - y < gh) ? job->y_end - y : gh;
 
-    unsigned int remaining_y = render_frame->dimy;
-    unsigned int job_n = 0;
+            for (unsigned int x = job->x_start; x < job->x_end; x += gw)
+            {
+                unsigned int w = (job->x_end - x < gw) ? job->x_end - x : gw;
 
-    while (remaining_y)
+                group_fragment(x, y, w, h, out);
+            }
+        }
+    }
+    else if (fragment_span != NULL)
     {
-        render_job *job;
-        unsigned int actual_ysize = job_ysize;
+        // Hand the shader whole segments of each row, written straight into the render frame
+        tup3 span_uv[FRAGMENT_SPAN_MAX];
 
-        if (actual_ysize > remaining_y)
+        for (unsigned int y = job->y_start; y < job->y_end; y++)
         {
-            actual_ysize = remaining_y;
-        }
+            tup3 *row = out->buf + (size_t) y * out->dimx;
+
+            if (row_setup != NULL)
+            {
+                row_setup(y);
+            }
 
-        job = job_init(0, job_xsize, job_ysize * job_n, job_ysize * job_n + actual_ysize);
+            for (unsigned int x = job->x_start; x < job->x_end; x += FRAGMENT_SPAN_MAX)
+            {
+                unsigned int n = job->x_end - x;
 
-        remaining_y -= actual_ysize;
-        job_n++;
+                if (n > FRAGMENT_SPAN_MAX)
+                {
+                    n = FRAGMENT_SPAN_MAX;
+                }
 
-        // Panic if there is insufficient memory for a new job
-        if (job == NULL)
-        {
-            exit(1);
-        }
+                for (unsigned int i = 0; i < n; i++)
+                {
+                    span_uv[i] = active_uv;
+                    span_uv[i].x = x + i;
+                    span_uv[i].y = y;
+                }
 
-        jobq_enqueue(jq, job);
+                fragment_span(span_uv, n, row + x);
+            }
+        }
     }
+    else if (fragment_x8 != NULL)
+    {
+        // Shade packets of adjacent pixels, with a masked packet at the end of each row
+        const f32x8 lane = { 0.0f, 1.0f, 2.0f, 3.0f, 4.0f, 5.0f, 6.0f, 7.0f };
+        mask8 all_active = mask_first_x8(TUP_LANES);
+        tup3x8 packet_uv = splat_t3x8(&active_uv);
 
-    // Wait for render jobs to be complete
-    jobq_wait_complete(jq);
+        for (unsigned int y = job->y_start; y < job->y_end; y++)
+        {
+            tup3 *row = out->buf + (size_t) y * out->dimx;
 
-    // Save current frame
-    save_frame(render_frame, FRAME_COUNT);
+            packet_uv.y = splat_x8(y);
 
-    // Copy current frame into BACKBUF
-    framebuf_copy(BACKBUF, render_frame);
+            if (row_setup != NULL)
+            {
+                row_setup(y);
+            }
 
-    // Update FRAME_COUNT uniform
-    FRAME_COUNT++;
+            for (unsigned int x = job->x_start; x < job->x_end; x += TUP_LANES)
+            {
+                unsigned int n = job->x_end - x;
+                tup3x8 packet_col;
 
-    // End if all frames are complete
-    if (FRAME_COUNT >= n_frames)
+                if (n >= TUP_LANES)
+                {
+                    packet_uv.x = splat_x8(x) + lane;
+                    packet_col = fragment_x8(&packet_uv, &all_active);
+
+                    store_t3x8(row + x, &packet_col, TUP_LANES);
+                }
+                else
+                {
+                    mask8 active = mask_first_x8(n);
+
+                    packet_uv.x = blend_x8(active, splat_x8(x) + lane, splat_x8(job->x_end - 1));
+                    packet_col = fragment_x8(&packet_uv, &active);
+
+                    store_t3x8(row + x, &packet_col, n);
+                }
+            }
+        }
+    }
+    else if (fragment_render_job != NULL)
     {
-        return 0;
+        // The render loop was instantiated alongside the shader, with `fragment` inlined
+        fragment_render_job(job, out);
     }
+    else
+    {
+        for (unsigned int y = job->y_start; y < job->y_end; y++)
+        {
+            if (row_setup != NULL)
+            {
+                row_setup(y);
+            }
 
-    return 1;
-}
+            for (unsigned int x = job->x_start; x < job->x_end; x++)
+            {
+                active_uv.x = x;
+                active_uv.y = y;
+
+                tup3 frag_col = fragment(&active_uv);
+
+                // Jobs always lie within the frame
+                framebuf_set(out, x, y, &frag_col);
+            }
+        }
+    }
+
+    // Record how long the job took, to re-plan the next frame
+    if (costmap != NULL)
+    {
+        clock_gettime(CLOCK_MONOTONIC, &end_t);
 
+        costmap_record(costmap, job, (end_t.tv_sec - start_t.tv_sec) * 1000000000ull
+                                     + end_t.tv_nsec - start_t.tv_nsec);
+    }
+}
 
 
-int main(int argc, char **argv)
+/*
+ * Sorts the lanes (rows or columns) of the render frame covered by a job of a sort pass
+ */
+static inline void sort_region(render_job *job)
 {
-    job_queue *jq;
-    pthread_t *thread_pool;
-    unsigned int active_threads = 0;
+    int err;
 
-    // Compute CONST_RAND uniform
-    srand(time(NULL));
-    CONST_RAND = (float) rand() / (float) RAND_MAX;
+    if (frame_sort.axis == SORT_AXIS_ROWS)
+    {
+        err = framebuf_sort_lanes(render_frame, SORT_AXIS_ROWS, frame_sort.segment_len, frame_sort.key,
+                                  job->y_start, job->y_end);
+    }
+    else
+    {
+        err = framebuf_sort_lanes(render_frame, SORT_AXIS_COLUMNS, frame_sort.segment_len, frame_sort.key,
+                                  job->x_start, job->x_end);
+    }
 
-    // Initialise CLOCK_NS
-    clock_gettime(CLOCK_MONOTONIC, &prev_t);
-    CLOCK_NS = 0;
+    if (err)
+    {
+        fputs("[ ERROR ] : Not enough memory to sort frame, leaving it partially unsorted\n", stderr);
+    }
+}
 
-    // Initialise based on user handler and arguments
-    frag_init(argc, argv);
 
-    // Validate frame, thread and job information
-    if (render_frame == NULL || n_threads < 1 || n_jobs < 1 || n_frames < 1)
+/*
+ * Carries out a job, of either the frame or a sort pass
+ */
+static inline void run_job(render_job *job)
+{
+    if (pass_active)
     {
-        // Clean goto - jumps forward, to greater or equal scope
-        goto user_cleanup;
+        sort_region(job);
+    }
+    else
+    {
+        render_region(job, render_frame, BACKBUF);
     }
+}
 
-    // Load frame dimensions into the uniform
-    FRAME_DIM.x = (float) render_frame->dimx;
-    FRAME_DIM.y = (float) render_frame->dimy;
 
-    // Create queue of render jobs
-    if ((jq = jobq_init()) == NULL)
+/*
+ * Sets up the per-thread uniforms of a rendering thread
+ */
+static void worker_start(unsigned int id)
+{
+    WORKER_ID = id;
+
+    // Without an arena, scratch allocations simply fail
+    if (scratch_size > 0)
     {
-        goto user_cleanup;
+        WORKER_SCRATCH = scratch_init(scratch_size);
     }
+}
 
-    // Dispatch all threads
-    thread_pool = malloc(sizeof(pthread_t) * n_threads);
 
-    if (thread_pool == NULL)
+/*
+ * Cleans up the per-thread uniforms of a rendering thread
+ */
+static void worker_finish(void)
+{
+    if (WORKER_SCRATCH != NULL)
     {
-        goto jobqueue_cleanup;
+        scratch_delete(WORKER_SCRATCH);
+        WORKER_SCRATCH = NULL;
     }
 
-    for (unsigned int i = 0; i < n_threads; i++)
+    free(STAGED.buf);
+    STAGED.buf = NULL;
+    staged_capacity = 0;
+
+    free(step_buf);
+    step_buf = NULL;
+    step_capacity = 0;
+}
+
+
+/*
+ * Copies a thread's home region of the render frame and BACKBUF into the untouched home
+ * framebuffers, so that their pages are placed local to the thread
+ *
+ * The home region is the thread's run of jobs when work stealing, or an even share of rows
+ */
+static void touch_home(job_dispenser *jd, unsigned int id, unsigned int n_participants)
+{
+    if (jd != NULL && jd->deques != NULL)
     {
-        if (pthread_create(thread_pool + i, NULL, fragment_thread_main, jq))
+        unsigned int run_start = (unsigned long long) jd->n_jobs * id / jd->n_deques;
+        unsigned int run_end = (unsigned long long) jd->n_jobs * (id + 1) / jd->n_deques;
+
+        for (unsigned int i = run_start; i < run_end; i++)
         {
-            goto thread_cleanup;
+            render_job *job = jd->jobs + i;
+
+            framebuf_copy_rect(home_frame, render_frame, job->x_start, job->x_end, job->y_start, job->y_end);
+            framebuf_copy_rect(home_backbuf, BACKBUF, job->x_start, job->x_end, job->y_start, job->y_end);
         }
+    }
+    else
+    {
+        unsigned int y_start = (unsigned long long) render_frame->dimy * id / n_participants;
+        unsigned int y_end = (unsigned long long) render_frame->dimy * (id + 1) / n_participants;
 
-        active_threads++;
+        framebuf_copy_rect(home_frame, render_frame, 0, render_frame->dimx, y_start, y_end);
+        framebuf_copy_rect(home_backbuf, BACKBUF, 0, render_frame->dimx, y_start, y_end);
     }
+}
 
-    // Enter main loop
-    while (fragment_main(jq));
 
-    // Enqueue "quit" jobs once the rendering is done
-thread_cleanup:
-    for (unsigned int j = 0; j < active_threads; j++)
+/*
+ * Determines the CPU that the given thread should be pinned to, cycling through
+ * the CPUs that the process may run on
+ */
+static int thread_cpu(unsigned int id)
+{
+    cpu_set_t allowed;
+    int n_allowed;
+    int nth;
+
+    if (sched_getaffinity(0, sizeof(cpu_set_t), &allowed) || (n_allowed = CPU_COUNT(&allowed)) == 0)
     {
-        render_job *quit_job = job_quit_init();
+        return -1;
+    }
+
+    nth = id % n_allowed;
 
-        if (quit_job == NULL)
+    for (int cpu = 0; cpu < CPU_SETSIZE; cpu++)
+    {
+        if (CPU_ISSET(cpu, &allowed) && nth-- == 0)
         {
-            // Panic if there is insufficient memory to send a quit job
-            exit(1);
+            return cpu;
         }
-
-        jobq_enqueue(jq, quit_job);
     }
 
-    // Join all threads
-    for (unsigned int k = 0; k < active_threads; k++)
-    {
-        pthread_join(thread_pool[k], NULL);
-    }
+    return -1;
+}
 
-    free(thread_pool);
 
-    // Delete the job queue
-jobqueue_cleanup:
-    jobq_delete(jq);
+static void *fragment_thread_main(void *args)
+{
+    job_queue *jq;
+    render_job *job;
+    int quit = 0;
 
+    jq = ((worker_args *)args)->jq;
 
-    // Clean up user resources
-user_cleanup:
-    frag_cleanup();
+    worker_start(((worker_args *)args)->id);
 
-    // Delete the framebuffers (if they exist)
-    if (render_frame != NULL)
+    // Place this thread's share of the framebuffers
+    if (home_barrier != NULL)
     {
-        framebuf_delete(render_frame);
+        touch_home(NULL, ((worker_args *)args)->id, n_threads);
+        fbar_wait(home_barrier);
     }
-    if (BACKBUF != NULL)
+
+    // Repeatedly try to acquire a render job
+    while (!quit)
     {
-        framebuf_delete(BACKBUF);
-    }
+        job = jobq_dequeue(jq);
+
+        if (job->quit)
+        {
+            quit = 1;
+        }
+        else
+        {
+            run_job(job);
+        }
+
+        job_delete(job);
+
+        // Report the completion of the job
+        jobq_report_complete(jq);
+    }
+
+    worker_finish();
+
+    return NULL;
+}
+
+
+static unsigned int render_dispensed(job_dispenser *jd, unsigned int id, unsigned int *seed)
+{
+    render_job *job;
+    unsigned int n_complete = 0;
+
+    // Claim jobs until none are left
+    while ((job = (jd->deques != NULL ? jobd_claim_local(jd, id, seed) : jobd_claim(jd))) != NULL)
+    {
+        run_job(job);
+        n_complete++;
+    }
+
+    return n_complete;
+}
+
+
+static void *fragment_thread_dispense(void *args)
+{
+    job_dispenser *jd;
+    unsigned long generation = 0;
+    unsigned int id;
+    unsigned int seed;
+
+    jd = ((worker_args *)args)->jd;
+    id = ((worker_args *)args)->id;
+    seed = id + 1;
+
+    worker_start(id);
+
+    // Place this thread's share of the framebuffers
+    if (home_barrier != NULL)
+    {
+        touch_home(jd, id, n_threads + (jd->barrier != NULL));
+        fbar_wait(home_barrier);
+    }
+
+    // Wait for each frame to start, then work through its jobs
+    while (jobd_wait_frame(jd, &generation))
+    {
+        unsigned int n_complete = render_dispensed(jd, id, &seed);
+
+        // Report all completed jobs at once
+        jobd_report_complete(jd, n_complete);
+    }
+
+    worker_finish();
+
+    return NULL;
+}
+
+
+static void *fragment_thread_wavefront(void *args)
+{
+    job_wavefront *jw;
+    render_job *job;
+    unsigned long frame;
+
+    jw = ((worker_args *)args)->jw;
+
+    worker_start(((worker_args *)args)->id);
+
+    // Place this thread's share of the framebuffers
+    if (home_barrier != NULL)
+    {
+        touch_home(NULL, ((worker_args *)args)->id, n_threads);
+        fbar_wait(home_barrier);
+    }
+
+    // Render whichever job is ready, staging the frame before it (or BACKBUF, for the first)
+    while ((job = jobw_claim(jw, &frame)) != NULL)
+    {
+        render_region(job, wave_frames[frame], (frame > 0) ? wave_frames[frame - 1] : BACKBUF);
+
+        jobw_report_complete(jw, job, frame);
+    }
+
+    worker_finish();
+
+    return NULL;
+}
+
+
+static unsigned int plan_frame_size(unsigned int max_jobs)
+{
+    if (tile_w && tile_h)
+    {
+        return job_plan_tile_count(render_frame->dimx, render_frame->dimy, tile_w, tile_h);
+    }
+
+    return max_jobs;
+}
+
+
+static unsigned int plan_frame(render_job *jobs, unsigned int max_jobs)
+{
+    if (group_fragment != NULL)
+    {
+        // Keep each group within one job, by growing tiles to a whole number of groups
+        unsigned int gw = group_w ? group_w : 1;
+        unsigned int gh = group_h ? group_h : 1;
+
+        planned_group_w = group_w;
+        planned_group_h = group_h;
+
+        if (tile_w && tile_h)
+        {
+            return job_plan_tiles(jobs, render_frame->dimx, render_frame->dimy,
+                                  (tile_w + gw - 1) / gw * gw, (tile_h + gh - 1) / gh * gh,
+                                  tile_traversal);
+        }
+
+        return job_plan_group_bands(jobs, max_jobs, render_frame->dimx, render_frame->dimy, gh);
+    }
+
+    if (tile_w && tile_h)
+    {
+        return job_plan_tiles(jobs, render_frame->dimx, render_frame->dimy, tile_w, tile_h, tile_traversal);
+    }
+
+    // Split into horizontal bands
+    return job_plan_bands(jobs, max_jobs, render_frame->dimx, render_frame->dimy);
+}
+
+
+static void replan_frame(job_dispenser *jd)
+{
+    render_job *jobs = jd != NULL ? jd->jobs : queue_plan;
+    unsigned int n = jd != NULL ? jd->n_jobs : queue_plan_n;
+
+    // Re-cut bands into pieces of equal cost (tiles, and bands of groups, keep their shape)
+    if (!(tile_w && tile_h) && group_fragment == NULL)
+    {
+        n = job_plan_bands_adaptive(jobs, plan_max_jobs, costmap);
+    }
+
+    // Issue the most expensive jobs first, to shorten the tail of the frame
+    // Work stealing keeps jobs in place, as each thread's run should stay contiguous
+    if (sched_mode != JOB_SCHED_STEAL)
+    {
+        job_plan_sort_cost(jobs, n, costmap);
+    }
+
+    if (jd != NULL)
+    {
+        jd->n_jobs = n;
+    }
+    else
+    {
+        queue_plan_n = n;
+    }
+}
+
+
+/*
+ * Hands out the dispenser's jobs (or the planned queue jobs) to the threads, and waits for them
+ * to be completed
+ */
+static void dispatch_jobs(job_queue *jq, job_dispenser *jd, render_job *jobs, unsigned int n)
+{
+    if (jd != NULL && jd->barrier != NULL)
+    {
+        // Release the workers, then work alongside them (as the final worker)
+        unsigned int seed = n_threads + 1;
+
+        jobd_start_frame(jd);
+
+        jobd_report_complete(jd, render_dispensed(jd, n_threads, &seed));
+    }
+    else if (jd != NULL)
+    {
+        // The jobs are already described, so just make them available
+        jobd_start_frame(jd);
+
+        // Wait for the jobs to be complete
+        jobd_wait_complete(jd);
+    }
+    else
+    {
+        // Enqueue all jobs at once
+        jobq_enqueue_batch(jq, jobs, n);
+
+        // Wait for the jobs to be complete
+        jobq_wait_complete(jq);
+    }
+}
+
+
+/*
+ * Sorts the segments of the render frame (see `frame_sort`), split between the threads
+ */
+static void sort_frame(job_queue *jq, job_dispenser *jd)
+{
+    unsigned int n;
+
+    // Split the lanes into bands, transposed into bands of columns when sorting columns
+    if (frame_sort.axis == SORT_AXIS_ROWS)
+    {
+        n = job_plan_bands(pass_plan, plan_max_jobs, render_frame->dimx, render_frame->dimy);
+    }
+    else
+    {
+        n = job_plan_bands(pass_plan, plan_max_jobs, render_frame->dimy, render_frame->dimx);
+
+        for (unsigned int i = 0; i < n; i++)
+        {
+            render_job band = pass_plan[i];
+
+            pass_plan[i].x_start = band.y_start;
+            pass_plan[i].x_end = band.y_end;
+            pass_plan[i].y_start = band.x_start;
+            pass_plan[i].y_end = band.x_end;
+        }
+    }
+
+    // Workers only read the flag (and the dispenser's jobs) once the pass is started
+    pass_active = 1;
+
+    if (jd != NULL)
+    {
+        render_job *frame_jobs = jd->jobs;
+        unsigned int frame_n = jd->n_jobs;
+
+        jd->jobs = pass_plan;
+        jd->n_jobs = n;
+
+        dispatch_jobs(jq, jd, NULL, 0);
+
+        jd->jobs = frame_jobs;
+        jd->n_jobs = frame_n;
+    }
+    else
+    {
+        dispatch_jobs(jq, NULL, pass_plan, n);
+    }
+
+    pass_active = 0;
+}
+
+
+/*
+ * Determines the number of frames that the jobs of the next block advance at once (see
+ * `stage_frames`)
+ */
+static unsigned int plan_block(void)
+{
+    unsigned int n = stage_frames;
+    unsigned int min_dim = render_frame->dimx;
+
+    if (render_frame->dimy < min_dim)
+    {
+        min_dim = render_frame->dimy;
+    }
+
+    // Frames between are only rendered by `fragment`, and only ever partially - they would be
+    // missing from the history, and are kept as rendered, rather than in BACKBUF's format
+    if (!stage_backbuf || n < 2 || fragment == NULL || frame_sort.enabled || stage_address == FB_ADDR_WRAP
+        || history_frames > 1 || backbuf_format != FB_FORMAT_TUP3)
+    {
+        return 1;
+    }
+
+    // The halo of every frame but the last must fit within the frame, to be mapped back into it
+    if (stage_halo > 0 && n > min_dim / stage_halo)
+    {
+        n = min_dim / stage_halo;
+    }
+
+    // The final block stops at the final frame
+    if (n > n_frames - FRAME_COUNT)
+    {
+        n = n_frames - FRAME_COUNT;
+    }
+
+    return (n > 1) ? n : 1;
+}
+
+
+/*
+ * Moves BACKBUF into the history ring (see `history_frames`), in place of the oldest frame
+ *
+ * Returns the framebuffer that is no longer kept (the oldest frame, or BACKBUF itself if there
+ * is no history), to be reused for the next frame
+ */
+static framebuf *push_history(void)
+{
+    unsigned int n_history = history_frames - 1;
+    framebuf *oldest;
+
+    if (backbuf_history == NULL)
+    {
+        return BACKBUF;
+    }
+
+    // The oldest frame's slot becomes the newest
+    backbuf_history_head = (backbuf_history_head + n_history - 1) % n_history;
+
+    oldest = backbuf_history[backbuf_history_head];
+    backbuf_history[backbuf_history_head] = BACKBUF;
+
+    return oldest;
+}
+
+
+static int fragment_main(job_queue *jq, job_dispenser *jd)
+{
+    // Update CLOCK_NS uniform
+    unsigned long long diff_s = prev_t.tv_sec;
+    unsigned long long diff_ns = prev_t.tv_nsec;
+
+    clock_gettime(CLOCK_MONOTONIC, &prev_t);
+
+    diff_s = prev_t.tv_sec - diff_s;
+    diff_ns = prev_t.tv_nsec - diff_ns;
+
+    CLOCK_NS += diff_ns + (diff_s * 1e9);
+
+    // Compute anything that is the same for every pixel of the frame, before any are rendered
+    if (frame_setup != NULL)
+    {
+        frame_setup();
+    }
+
+    // Re-align jobs if the groups were resized
+    if (group_fragment != NULL && (group_w != planned_group_w || group_h != planned_group_h))
+    {
+        if (jd != NULL)
+        {
+            jd->n_jobs = plan_frame(jd->jobs, plan_max_jobs);
+        }
+        else
+        {
+            queue_plan_n = plan_frame(queue_plan, plan_max_jobs);
+        }
+    }
+
+    // Advance several frames at once, when only the last of them needs to be whole
+    block_frames = plan_block();
+
+    dispatch_jobs(jq, jd, queue_plan, queue_plan_n);
+
+    // Adapt the next frame's jobs to the cost of this one
+    if (costmap != NULL)
+    {
+        replan_frame(jd);
+    }
+
+    // Sort the finished frame, before it is saved or read as BACKBUF
+    if (frame_sort.enabled)
+    {
+        sort_frame(jq, jd);
+    }
+
+    // Only the last frame of a block was rendered whole
+    unsigned long block_start = FRAME_COUNT;
+
+    FRAME_COUNT += block_frames - 1;
+
+    // Save current frame, and make it BACKBUF
+    if (writer != NULL && swap_backbuf)
+    {
+        // The frame is read as BACKBUF while being saved, and the previous BACKBUF is either
+        // the writer's (to be recycled once saved) or the initial BACKBUF (no longer needed)
+        fwriter_submit(writer, render_frame, FRAME_COUNT);
+
+        if (block_start == 0)
+        {
+            framebuf_delete(BACKBUF);
+        }
+
+        BACKBUF = render_frame;
+        render_frame = fwriter_acquire(writer, BACKBUF);
+    }
+    else if (writer != NULL)
+    {
+        // Hand the frame over to be saved, and render the next into a spare
+        BACKBUF = push_history();
+        framebuf_copy(BACKBUF, render_frame);
+
+        fwriter_submit(writer, render_frame, FRAME_COUNT);
+        render_frame = fwriter_acquire(writer, NULL);
+    }
+    else
+    {
+        save_frame(render_frame, FRAME_COUNT);
+
+        if (swap_backbuf)
+        {
+            // The next frame overwrites every pixel of the old BACKBUF (or the oldest frame of
+            // the history), so just trade them
+            framebuf *prev = push_history();
+
+            BACKBUF = render_frame;
+            render_frame = prev;
+        }
+        else
+        {
+            BACKBUF = push_history();
+            framebuf_copy(BACKBUF, render_frame);
+        }
+    }
+
+    // Update FRAME_COUNT uniform
+    FRAME_COUNT++;
+
+    // End if all frames are complete
+    if (FRAME_COUNT >= n_frames)
+    {
+        return 0;
+    }
+
+    return 1;
+}
+
+
+
+/*
+ * Renders every frame through the wavefront, saving each as soon as it is complete (while the
+ * next is already being rendered), then releasing its framebuffer to the frame two after it
+ */
+static void wavefront_main(job_wavefront *jw)
+{
+    wave_frames[0] = render_frame;
+    wave_frames[1] = wave_spare;
+
+    jobw_start(jw, n_frames);
+
+    for (unsigned long frame = 0; frame < n_frames; frame++)
+    {
+        jobw_wait_frame(jw, frame);
+
+        if (writer != NULL)
+        {
+            // The next frame still reads this one, so it must not be handed straight back out
+            fwriter_submit(writer, wave_frames[frame], frame);
+
+            if (frame + 2 < n_frames)
+            {
+                wave_frames[frame + 2] = fwriter_acquire(writer, wave_frames[frame]);
+            }
+        }
+        else
+        {
+            save_frame(wave_frames[frame], frame);
+
+            if (frame + 2 < n_frames)
+            {
+                wave_frames[frame + 2] = wave_frames[frame];
+            }
+        }
+
+        jobw_release_frame(jw, frame);
+    }
+
+    // Every framebuffer rendered into now belongs to the writer
+    if (writer != NULL)
+    {
+        render_frame = NULL;
+
+        if (n_frames > 1)
+        {
+            wave_spare = NULL;
+        }
+    }
+
+    FRAME_COUNT = n_frames;
+}
+
+
+
+int main(int argc, char **argv)
+{
+    job_queue *jq = NULL;
+    job_dispenser *jd = NULL;
+    job_wavefront *jw = NULL;
+    worker_args *w_args = NULL;
+    pthread_t *thread_pool = NULL;
+    unsigned int active_threads = 0;
+
+    // Compute CONST_RAND uniform
+    srand(time(NULL));
+    CONST_RAND = (float) rand() / (float) RAND_MAX;
+
+    // Initialise CLOCK_NS
+    clock_gettime(CLOCK_MONOTONIC, &prev_t);
+    CLOCK_NS = 0;
+
+    // Initialise based on user handler and arguments
+    frag_init(argc, argv);
+
+    // Apply any properties that the shader was specialised for
+    if (&frag_baked_threads != NULL)
+    {
+        n_threads = frag_baked_threads;
+    }
+
+    if (&frag_baked_jobs != NULL)
+    {
+        n_jobs = frag_baked_jobs;
+    }
+
+    if (frag_baked_dim != NULL && render_frame != NULL
+        && (render_frame->dimx != frag_baked_dim[0] || render_frame->dimy != frag_baked_dim[1]))
+    {
+        fprintf(stderr, "[ ERROR ] : Shader was compiled for a %ux%u frame, not %ux%u\n",
+                frag_baked_dim[0], frag_baked_dim[1], render_frame->dimx, render_frame->dimy);
+
+        goto user_cleanup;
+    }
+
+    // Validate frame, thread and job information
+    if (render_frame == NULL || n_threads < 1 || n_jobs < 1 || n_frames < 1)
+    {
+        // Clean goto - jumps forward, to greater or equal scope
+        goto user_cleanup;
+    }
+
+    // Validate that the shader can render pixels
+    if (fragment == NULL && fragment_span == NULL && fragment_x8 == NULL && group_fragment == NULL)
+    {
+        fputs("[ ERROR ] : Shader does not provide a fragment function\n", stderr);
+
+        goto user_cleanup;
+    }
+
+    // Store BACKBUF in its requested format and layout - frames are then converted into it,
+    // not traded
+    if (BACKBUF->format != backbuf_format || BACKBUF->layout != backbuf_layout)
+    {
+        framebuf *converted = framebuf_alloc_layout(BACKBUF->dimx, BACKBUF->dimy, backbuf_format,
+                                                    backbuf_layout);
+
+        if (converted == NULL)
+        {
+            goto user_cleanup;
+        }
+
+        framebuf_copy(converted, BACKBUF);
+        framebuf_delete(BACKBUF);
+
+        BACKBUF = converted;
+
+        // The history takes turns with BACKBUF, so is stored alike
+        for (unsigned int i = 0; backbuf_history != NULL && i < history_frames - 1; i++)
+        {
+            converted = framebuf_alloc_layout(BACKBUF->dimx, BACKBUF->dimy, backbuf_format, backbuf_layout);
+
+            if (converted == NULL)
+            {
+                goto user_cleanup;
+            }
+
+            framebuf_copy(converted, backbuf_history[i]);
+            framebuf_delete(backbuf_history[i]);
+
+            backbuf_history[i] = converted;
+        }
+    }
+
+    if (BACKBUF->format != render_frame->format || BACKBUF->layout != render_frame->layout)
+    {
+        swap_backbuf = 0;
+    }
+
+    // Frames swapped into the writer are recycled once saved, so could not be kept in the history
+    if (pipeline_depth > 0 && history_frames > 1)
+    {
+        swap_backbuf = 0;
+    }
+
+    // Load frame dimensions into the uniform
+    FRAME_DIM.x = (float) render_frame->dimx;
+    FRAME_DIM.y = (float) render_frame->dimy;
+
+    // A wavefront renders into two frames at once, besides the one being saved
+    if (sched_mode == JOB_SCHED_WAVEFRONT && pipeline_depth == 1)
+    {
+        pipeline_depth = 2;
+    }
+
+    // Save frames on dedicated threads, so that rendering continues in the meantime
+    if (pipeline_depth > 0)
+    {
+        writer = fwriter_init(pipeline_depth, n_writers, render_frame->dimx, render_frame->dimy);
+
+        if (writer == NULL)
+        {
+            goto user_cleanup;
+        }
+    }
+
+    plan_max_jobs = n_jobs;
+
+    // Make sure that there is enough work to steal, without hand tuning
+    if (sched_mode == JOB_SCHED_STEAL && plan_max_jobs < n_threads * JOB_STEAL_SPLIT)
+    {
+        plan_max_jobs = n_threads * JOB_STEAL_SPLIT;
+    }
+
+    // Sort passes are split into bands, even when frames are tiled
+    if ((pass_plan = malloc(sizeof(render_job) * plan_max_jobs)) == NULL)
+    {
+        goto user_cleanup;
+    }
+
+    // Measure the cost of each tile, or of each row when using bands (frames overlap in a wavefront,
+    // so are never re-planned)
+    if (adaptive_jobs && sched_mode != JOB_SCHED_WAVEFRONT)
+    {
+        if (tile_w && tile_h)
+        {
+            costmap = costmap_init(render_frame->dimx, render_frame->dimy, tile_w, tile_h);
+        }
+        else
+        {
+            costmap = costmap_init(render_frame->dimx, render_frame->dimy, render_frame->dimx, 1);
+        }
+
+        if (costmap == NULL)
+        {
+            goto user_cleanup;
+        }
+    }
+
+    if (sched_mode == JOB_SCHED_WAVEFRONT)
+    {
+        // The shader declares what it reads of each frame once, before any are rendered
+        if (frame_setup != NULL)
+        {
+            frame_setup();
+        }
+
+        // Jobs only wait on their neighbours, so the halo must not wrap around to the far edges, and
+        // stage each frame as it was rendered, so BACKBUF must be stored as rendered
+        if (!stage_backbuf || stage_address == FB_ADDR_WRAP || backbuf_format != FB_FORMAT_TUP3
+            || frame_sort.enabled || history_frames > 1)
+        {
+            fputs("[ ERROR ] : Wavefront scheduling requires a staged, unwrapped, full precision BACKBUF, "
+                  "and no sort or history\n", stderr);
+
+            goto user_cleanup;
+        }
+
+        // Frames alternate between framebuffers, so BACKBUF is only read by the first
+        swap_backbuf = 0;
+
+        // Only the render frame may circulate through the writer alongside its own framebuffers
+        if (writer != NULL)
+        {
+            wave_spare = fwriter_acquire(writer, NULL);
+        }
+        else
+        {
+            wave_spare = framebuf_alloc(render_frame->dimx, render_frame->dimy);
+        }
+
+        wave_frames = malloc(sizeof(framebuf *) * (n_frames + 1));
+
+        if (wave_spare == NULL || wave_frames == NULL)
+        {
+            goto user_cleanup;
+        }
+
+        // Describe the frame's jobs once, and what each depends upon in the frame before
+        if ((jw = jobw_init(plan_frame_size(plan_max_jobs))) == NULL)
+        {
+            goto user_cleanup;
+        }
+
+        jw->n_jobs = plan_frame(jw->jobs, plan_max_jobs);
+
+        if (jobw_link(jw, stage_halo))
+        {
+            goto jobqueue_cleanup;
+        }
+    }
+    else if (sched_mode == JOB_SCHED_ATOMIC || sched_mode == JOB_SCHED_STEAL)
+    {
+        // Describe the frame's jobs once, to be dispensed every frame
+        if ((jd = jobd_init(plan_frame_size(plan_max_jobs))) == NULL)
+        {
+            goto user_cleanup;
+        }
+
+        jd->n_jobs = plan_frame(jd->jobs, plan_max_jobs);
+
+        // With a barrier, the main thread also renders (with its own deque)
+        unsigned int n_participants = n_threads + (sync_mode == FRAME_SYNC_BARRIER);
+
+        if (sched_mode == JOB_SCHED_STEAL && jobd_enable_stealing(jd, n_participants))
+        {
+            goto jobqueue_cleanup;
+        }
+
+        if (sync_mode == FRAME_SYNC_BARRIER && jobd_enable_barrier(jd, n_participants))
+        {
+            goto jobqueue_cleanup;
+        }
+    }
+    else
+    {
+        unsigned int plan_size = plan_frame_size(plan_max_jobs);
+
+        // Describe the frame's jobs (and the quit jobs) once, to be enqueued every frame
+        if ((queue_plan = malloc(sizeof(render_job) * (plan_size + n_threads))) == NULL)
+        {
+            goto user_cleanup;
+        }
+
+        queue_plan_n = plan_frame(queue_plan, plan_max_jobs);
+
+        queue_quit = queue_plan + plan_size;
+        job_plan_quit(queue_quit, n_threads);
+
+        // Create queue of render jobs
+        if ((jq = jobq_init()) == NULL)
+        {
+            goto user_cleanup;
+        }
+    }
+
+    // Have threads place their share of the framebuffers, once pinned
+    if (pin_threads)
+    {
+        home_frame = framebuf_alloc(render_frame->dimx, render_frame->dimy);
+        home_backbuf = framebuf_alloc_layout(BACKBUF->dimx, BACKBUF->dimy, BACKBUF->format, BACKBUF->layout);
+        home_barrier = fbar_init(n_threads + 1);
+
+        if (home_frame == NULL || home_backbuf == NULL || home_barrier == NULL)
+        {
+            goto jobqueue_cleanup;
+        }
+    }
+
+    // Dispatch all threads
+    thread_pool = malloc(sizeof(pthread_t) * n_threads);
+    w_args = malloc(sizeof(worker_args) * n_threads);
+
+    if (thread_pool == NULL || w_args == NULL)
+    {
+        goto jobqueue_cleanup;
+    }
+
+    for (unsigned int i = 0; i < n_threads; i++)
+    {
+        // Each thread has its own attributes, so that no thread inherits another's CPU
+        pthread_attr_t thread_attr;
+        int err;
+        int cpu;
+
+        w_args[i].jq = jq;
+        w_args[i].jd = jd;
+        w_args[i].jw = jw;
+        w_args[i].id = i;
+
+        if (pthread_attr_init(&thread_attr))
+        {
+            goto thread_cleanup;
+        }
+
+        // Pin each thread to its own CPU, from the moment it starts
+        if (pin_threads && (cpu = thread_cpu(i)) >= 0)
+        {
+            cpu_set_t cpus;
+
+            CPU_ZERO(&cpus);
+            CPU_SET(cpu, &cpus);
+
+            pthread_attr_setaffinity_np(&thread_attr, sizeof(cpu_set_t), &cpus);
+        }
+
+        if (jw != NULL)
+        {
+            err = pthread_create(thread_pool + i, &thread_attr, fragment_thread_wavefront, w_args + i);
+        }
+        else if (jd != NULL)
+        {
+            err = pthread_create(thread_pool + i, &thread_attr, fragment_thread_dispense, w_args + i);
+        }
+        else
+        {
+            err = pthread_create(thread_pool + i, &thread_attr, fragment_thread_main, w_args + i);
+        }
+
+        pthread_attr_destroy(&thread_attr);
+
+        if (err)
+        {
+            goto thread_cleanup;
+        }
+
+        active_threads++;
+    }
+
+    if (home_barrier != NULL)
+    {
+        // The main thread has its own share when it renders alongside the workers
+        if (jd != NULL && jd->barrier != NULL)
+        {
+            int cpu = thread_cpu(n_threads);
+
+            if (cpu >= 0)
+            {
+                cpu_set_t cpus;
+
+                CPU_ZERO(&cpus);
+                CPU_SET(cpu, &cpus);
+
+                pthread_setaffinity_np(pthread_self(), sizeof(cpu_set_t), &cpus);
+            }
+
+            touch_home(jd, n_threads, n_threads + 1);
+        }
+
+        fbar_wait(home_barrier);
+
+        // Swap in the placed framebuffers
+        framebuf_delete(render_frame);
+        framebuf_delete(BACKBUF);
+
+        render_frame = home_frame;
+        BACKBUF = home_backbuf;
+
+        home_frame = NULL;
+        home_backbuf = NULL;
+    }
+
+    // Enter main loop
+    // The main thread may render alongside the others
+    worker_start(n_threads);
+
+    if (jw != NULL)
+    {
+        wavefront_main(jw);
+    }
+    else
+    {
+        while (fragment_main(jq, jd));
+    }
+
+    worker_finish();
+
+    // Signal threads to quit once the rendering is done
+thread_cleanup:
+    // Release any threads still waiting to place their share of the framebuffers
+    if (home_frame != NULL && home_barrier != NULL)
+    {
+        fbar_resize(home_barrier, active_threads + 1);
+        fbar_wait(home_barrier);
+    }
+
+    if (jd != NULL)
+    {
+        // Only the threads that were actually created can meet at the barrier
+        if (jd->barrier != NULL && active_threads < n_threads)
+        {
+            fbar_resize(jd->barrier, active_threads + 1);
+        }
+
+        jobd_quit(jd);
+    }
+    else if (jw != NULL)
+    {
+        jobw_quit(jw);
+    }
+    else
+    {
+        jobq_enqueue_batch(jq, queue_quit, active_threads);
+    }
+
+    // Join all threads
+    for (unsigned int k = 0; k < active_threads; k++)
+    {
+        pthread_join(thread_pool[k], NULL);
+    }
+
+    // Delete the job dispenser or job queue
+jobqueue_cleanup:
+    free(thread_pool);
+    free(w_args);
+
+    if (home_barrier != NULL)
+    {
+        fbar_delete(home_barrier);
+    }
+    if (home_frame != NULL)
+    {
+        framebuf_delete(home_frame);
+    }
+    if (home_backbuf != NULL)
+    {
+        framebuf_delete(home_backbuf);
+    }
+
+    if (jd != NULL)
+    {
+        jobd_delete(jd);
+    }
+    else if (jw != NULL)
+    {
+        jobw_delete(jw);
+    }
+    else
+    {
+        jobq_delete(jq);
+    }
+
+
+    // Clean up user resources
+user_cleanup:
+    // Finish saving any frames still in the pipeline
+    if (writer != NULL)
+    {
+        // BACKBUF belongs to the writer, once a frame has been swapped into it
+        if (swap_backbuf && FRAME_COUNT > 0)
+        {
+            BACKBUF = NULL;
+        }
+
+        fwriter_delete(writer);
+    }
+
+    frag_cleanup();
+
+    free(queue_plan);
+    free(pass_plan);
+    free(wave_frames);
+
+    if (costmap != NULL)
+    {
+        costmap_delete(costmap);
+    }
+
+    // Delete the framebuffers (if they exist)
+    if (render_frame != NULL)
+    {
+        framebuf_delete(render_frame);
+    }
+    if (BACKBUF != NULL)
+    {
+        framebuf_delete(BACKBUF);
+    }
+    if (wave_spare != NULL)
+    {
+        framebuf_delete(wave_spare);
+    }
+    for (unsigned int i = 0; backbuf_history != NULL && i < history_frames - 1; i++)
+    {
+        framebuf_delete(backbuf_history[i]);
+    }
+
+    free(backbuf_history);
 
     // Delete the frame_output (if it exists)
     free_frame_output();
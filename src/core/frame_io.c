@@ -2,7 +2,53 @@
 
 // -----===[ Globals ]===-----
 
-frame_output *f_out = NULL;
+static frame_output *f_out = NULL;
+
+
+// -----===[ Internal ]===-----
+
+/*
+ * The entry point of each writer thread - saves pending frames until told to quit
+ */
+static void *fwriter_main(void *args)
+{
+    frame_writer *fw = (frame_writer *)args;
+    pending_frame next;
+
+    pthread_mutex_lock(&fw->lock);
+
+    while (1)
+    {
+        while (fw->n_pending == 0 && !fw->quit)
+        {
+            pthread_cond_wait(&fw->has_pending, &fw->lock);
+        }
+
+        // Only quit once every pending frame has been saved
+        if (fw->n_pending == 0)
+        {
+            break;
+        }
+
+        next = fw->pending[fw->pending_head];
+
+        fw->pending_head = (fw->pending_head + 1) % (fw->depth + 1);
+        fw->n_pending--;
+
+        pthread_mutex_unlock(&fw->lock);
+
+        save_frame(next.fb, next.framenum);
+
+        pthread_mutex_lock(&fw->lock);
+
+        fw->spare[fw->n_spare++] = next.fb;
+        pthread_cond_signal(&fw->has_spare);
+    }
+
+    pthread_mutex_unlock(&fw->lock);
+
+    return NULL;
+}
 
 
 // -----===[ Functions ]===-----
@@ -168,3 +214,193 @@ void save_frame(framebuf *fb, unsigned long framenum)
 
     free(frame_name);
 }
+
+
+frame_writer *fwriter_init(unsigned int depth, unsigned int n_writers, unsigned int dimx,
+                           unsigned int dimy)
+{
+    frame_writer *fw;
+
+    if (depth < 1 || n_writers < 1)
+    {
+        return NULL;
+    }
+
+    fw = malloc(sizeof(frame_writer));
+
+    if (fw == NULL)
+    {
+        goto exit_fail;
+    }
+
+    fw->depth = depth;
+    fw->n_spare = 0;
+    fw->pending_head = 0;
+    fw->n_pending = 0;
+    fw->n_writers = 0;
+    fw->quit = 0;
+
+    // The caller's own framebuffer also circulates through the writer
+    fw->spare = malloc(sizeof(framebuf *) * (depth + 1));
+
+    if (fw->spare == NULL)
+    {
+        goto fw_cleanup;
+    }
+
+    fw->pending = malloc(sizeof(pending_frame) * (depth + 1));
+
+    if (fw->pending == NULL)
+    {
+        goto spare_cleanup;
+    }
+
+    fw->writers = malloc(sizeof(pthread_t) * n_writers);
+
+    if (fw->writers == NULL)
+    {
+        goto pending_cleanup;
+    }
+
+    for (; fw->n_spare < depth; fw->n_spare++)
+    {
+        fw->spare[fw->n_spare] = framebuf_alloc(dimx, dimy);
+
+        if (fw->spare[fw->n_spare] == NULL)
+        {
+            goto framebuf_cleanup;
+        }
+    }
+
+    if (pthread_mutex_init(&fw->lock, NULL))
+    {
+        goto framebuf_cleanup;
+    }
+
+    if (pthread_cond_init(&fw->has_pending, NULL))
+    {
+        goto mutex_cleanup;
+    }
+
+    if (pthread_cond_init(&fw->has_spare, NULL))
+    {
+        goto pending_cond_cleanup;
+    }
+
+    for (; fw->n_writers < n_writers; fw->n_writers++)
+    {
+        if (pthread_create(fw->writers + fw->n_writers, NULL, fwriter_main, fw))
+        {
+            // Stops the writers that were created, and cleans up
+            fwriter_delete(fw);
+            return NULL;
+        }
+    }
+
+    return fw;
+
+pending_cond_cleanup:
+    pthread_cond_destroy(&fw->has_pending);
+
+mutex_cleanup:
+    pthread_mutex_destroy(&fw->lock);
+
+framebuf_cleanup:
+    for (unsigned int i = 0; i < fw->n_spare; i++)
+    {
+        framebuf_delete(fw->spare[i]);
+    }
+
+    free(fw->writers);
+
+pending_cleanup:
+    free(fw->pending);
+
+spare_cleanup:
+    free(fw->spare);
+
+fw_cleanup:
+    free(fw);
+
+exit_fail:
+    return NULL;
+}
+
+
+void fwriter_delete(frame_writer *fw)
+{
+    pthread_mutex_lock(&fw->lock);
+
+    fw->quit = 1;
+    pthread_cond_broadcast(&fw->has_pending);
+
+    pthread_mutex_unlock(&fw->lock);
+
+    for (unsigned int i = 0; i < fw->n_writers; i++)
+    {
+        pthread_join(fw->writers[i], NULL);
+    }
+
+    // Every pending frame has now been saved, and returned as a spare
+    for (unsigned int i = 0; i < fw->n_spare; i++)
+    {
+        framebuf_delete(fw->spare[i]);
+    }
+
+    pthread_cond_destroy(&fw->has_spare);
+    pthread_cond_destroy(&fw->has_pending);
+    pthread_mutex_destroy(&fw->lock);
+
+    free(fw->writers);
+    free(fw->pending);
+    free(fw->spare);
+    free(fw);
+}
+
+
+void fwriter_submit(frame_writer *fw, framebuf *fb, unsigned long framenum)
+{
+    pthread_mutex_lock(&fw->lock);
+
+    // There is always room, as only the writer's framebuffers (and the caller's) circulate
+    unsigned int tail = (fw->pending_head + fw->n_pending) % (fw->depth + 1);
+
+    fw->pending[tail].fb = fb;
+    fw->pending[tail].framenum = framenum;
+    fw->n_pending++;
+
+    pthread_cond_signal(&fw->has_pending);
+
+    pthread_mutex_unlock(&fw->lock);
+}
+
+
+framebuf *fwriter_acquire(frame_writer *fw, framebuf *in_use)
+{
+    framebuf *fb = NULL;
+
+    pthread_mutex_lock(&fw->lock);
+
+    while (fb == NULL)
+    {
+        // Take any spare, other than the framebuffer still in use
+        for (unsigned int i = 0; i < fw->n_spare; i++)
+        {
+            if (fw->spare[i] != in_use)
+            {
+                fb = fw->spare[i];
+                fw->spare[i] = fw->spare[--fw->n_spare];
+                break;
+            }
+        }
+
+        if (fb == NULL)
+        {
+            pthread_cond_wait(&fw->has_spare, &fw->lock);
+        }
+    }
+
+    pthread_mutex_unlock(&fw->lock);
+
+    return fb;
+}
@@ -1,11 +1,161 @@
 #include "core/framebuffer.h"
 
+#include <stdint.h>
+#include <string.h>
+#include <math.h>
+
+// -----===[ Internal Functions ]===-----
+
+// Segments shorter than this are insertion sorted, as radix sorting has a fixed cost
+#define SORT_INSERTION_MAX (48)
+
+// The most pixels staged at once when copying between layouts
+#define FB_COPY_CHUNK (64)
+
+
+/*
+ * Gives the number of pixels from x (up to x_end) that are contiguous in memory - the rest of
+ * the row if linear, the rest of the tile's row if tiled, or a pair if Morton ordered
+ */
+static inline unsigned int row_run(framebuf *fb, unsigned int x, unsigned int x_end)
+{
+    unsigned int run_end;
+
+    switch (fb->layout)
+    {
+        case FB_LAYOUT_TILED:
+            run_end = (x | (FB_TILE_DIM - 1)) + 1;
+            break;
+
+        case FB_LAYOUT_MORTON:
+            run_end = (x | 1u) + 1;
+            break;
+
+        default:
+            run_end = x_end;
+            break;
+    }
+
+    return (run_end < x_end ? run_end : x_end) - x;
+}
+
+
+/*
+ * Quantises a key to 16 bits, clamping it to [0, 1]
+ */
+static inline uint16_t quantise_key(float key)
+{
+    if (!(key > 0.0f))
+    {
+        return 0;
+    }
+
+    if (key >= 1.0f)
+    {
+        return UINT16_MAX;
+    }
+
+    return (uint16_t) (key * UINT16_MAX + 0.5f);
+}
+
+
+/*
+ * Stably sorts pixels (in place) by their quantised keys, using `tmp_keys` and `tmp_px`
+ * (each of n entries) as scratch
+ */
+static void sort_keyed(uint16_t *keys, tup3 *px, unsigned int n, uint16_t *tmp_keys, tup3 *tmp_px)
+{
+    if (n <= SORT_INSERTION_MAX)
+    {
+        for (unsigned int i = 1; i < n; i++)
+        {
+            uint16_t k = keys[i];
+            tup3 p = px[i];
+            unsigned int j = i;
+
+            for (; j > 0 && keys[j - 1] > k; j--)
+            {
+                keys[j] = keys[j - 1];
+                px[j] = px[j - 1];
+            }
+
+            keys[j] = k;
+            px[j] = p;
+        }
+
+        return;
+    }
+
+    // Least significant digit first, one byte at a time - two passes leave the result in place
+    for (unsigned int shift = 0; shift < 16; shift += 8)
+    {
+        unsigned int offsets[256] = { 0 };
+
+        for (unsigned int i = 0; i < n; i++)
+        {
+            offsets[(keys[i] >> shift) & 0xFF]++;
+        }
+
+        for (unsigned int b = 0, total = 0; b < 256; b++)
+        {
+            unsigned int count = offsets[b];
+
+            offsets[b] = total;
+            total += count;
+        }
+
+        for (unsigned int i = 0; i < n; i++)
+        {
+            unsigned int dest = offsets[(keys[i] >> shift) & 0xFF]++;
+
+            tmp_keys[dest] = keys[i];
+            tmp_px[dest] = px[i];
+        }
+
+        memcpy(keys, tmp_keys, sizeof(uint16_t) * n);
+        memcpy(px, tmp_px, sizeof(tup3) * n);
+    }
+}
+
+
+// -----===[ Functions ]===-----
+
 // < Framebuffer Memory >
 
-framebuf *framebuf_init(unsigned int dimx, unsigned int dimy)
+size_t framebuf_px_size(fb_format format)
+{
+    switch (format)
+    {
+        case FB_FORMAT_RGBA8:
+            return sizeof(fb_rgba8);
+
+        case FB_FORMAT_RGBA16F:
+            return sizeof(fb_rgba16f);
+
+        case FB_FORMAT_RGB32F:
+            return sizeof(fb_rgb32f);
+
+        default:
+            return sizeof(tup3);
+    }
+}
+
+
+framebuf *framebuf_alloc_layout(unsigned int dimx, unsigned int dimy, fb_format format, fb_layout layout)
 {
     framebuf *new_fb;
-    tup3 *new_buf;
+    void *new_data;
+    size_t n_px = (size_t) dimx * dimy;
+    unsigned int tiles_x = 0;
+
+    // Tiled layouts are padded out to whole tiles
+    if (layout != FB_LAYOUT_LINEAR)
+    {
+        unsigned int tiles_y = (dimy + FB_TILE_DIM - 1) >> FB_TILE_SHIFT;
+
+        tiles_x = (dimx + FB_TILE_DIM - 1) >> FB_TILE_SHIFT;
+        n_px = ((size_t) tiles_x * tiles_y) << (2 * FB_TILE_SHIFT);
+    }
 
     // Try to create the framebuf itself
     if ((new_fb = malloc(sizeof(framebuf))) == NULL)
@@ -14,7 +164,7 @@ framebuf *framebuf_init(unsigned int dimx, unsigned int dimy)
     }
 
     // Try to create the new pixel buffer for the framebuf
-    if ((new_buf = malloc(sizeof(tup3) * dimx * dimy)) == NULL)
+    if ((new_data = malloc(framebuf_px_size(format) * n_px)) == NULL)
     {
         free(new_fb);
         return NULL;
@@ -22,9 +172,37 @@ framebuf *framebuf_init(unsigned int dimx, unsigned int dimy)
 
     new_fb->dimx = dimx;
     new_fb->dimy = dimy;
-    new_fb->buf = new_buf;
+    new_fb->data = new_data;
+    new_fb->buf = (format == FB_FORMAT_TUP3) ? new_data : NULL;
+    new_fb->format = format;
+    new_fb->layout = layout;
+    new_fb->tiles_x = tiles_x;
+
+    return new_fb;
+}
 
 
+framebuf *framebuf_alloc_fmt(unsigned int dimx, unsigned int dimy, fb_format format)
+{
+    return framebuf_alloc_layout(dimx, dimy, format, FB_LAYOUT_LINEAR);
+}
+
+
+framebuf *framebuf_alloc(unsigned int dimx, unsigned int dimy)
+{
+    return framebuf_alloc_fmt(dimx, dimy, FB_FORMAT_TUP3);
+}
+
+
+framebuf *framebuf_init_layout(unsigned int dimx, unsigned int dimy, fb_format format, fb_layout layout)
+{
+    framebuf *new_fb;
+
+    if ((new_fb = framebuf_alloc_layout(dimx, dimy, format, layout)) == NULL)
+    {
+        return NULL;
+    }
+
     // Initialise the buffer to all opaque black
     tup3 black = col_xyz(0.0f, 0.0f, 0.0f);
 
@@ -32,7 +210,7 @@ framebuf *framebuf_init(unsigned int dimx, unsigned int dimy)
     {
         for (unsigned int x = 0; x < dimx; x++)
         {
-            new_buf[x + (y * dimx)] = black;
+            framebuf_set(new_fb, x, y, &black);
         }
     }
 
@@ -40,9 +218,21 @@ framebuf *framebuf_init(unsigned int dimx, unsigned int dimy)
 }
 
 
+framebuf *framebuf_init_fmt(unsigned int dimx, unsigned int dimy, fb_format format)
+{
+    return framebuf_init_layout(dimx, dimy, format, FB_LAYOUT_LINEAR);
+}
+
+
+framebuf *framebuf_init(unsigned int dimx, unsigned int dimy)
+{
+    return framebuf_init_fmt(dimx, dimy, FB_FORMAT_TUP3);
+}
+
+
 void framebuf_delete(framebuf *fb)
 {
-    free(fb->buf);
+    free(fb->data);
     free(fb);
 }
 
@@ -56,7 +246,7 @@ int framebuf_write(framebuf *fb, unsigned int x, unsigned int y, tup3 *colour)
     {
         if (y < fb->dimy)
         {
-            fb->buf[x + (y * fb->dimx)] = *colour;
+            framebuf_set(fb, x, y, colour);
             return 0;
         }
     }
@@ -74,7 +264,7 @@ int framebuf_read(framebuf *fb, unsigned int x, unsigned int y, tup3 *dest)
         {
             if (dest != NULL)
             {
-                *dest = fb->buf[x + (y * fb->dimx)];
+                *dest = framebuf_get(fb, x, y);
             }
 
             return 0;
@@ -86,24 +276,384 @@ int framebuf_read(framebuf *fb, unsigned int x, unsigned int y, tup3 *dest)
 
 
 int framebuf_copy(framebuf *dest, framebuf *src)
+{
+    return framebuf_copy_rect(dest, src, 0, src->dimx, 0, src->dimy);
+}
+
+
+int framebuf_copy_rect(framebuf *dest, framebuf *src, unsigned int x_start, unsigned int x_end,
+                       unsigned int y_start, unsigned int y_end)
 {
     if (dest == src)
     {
         return -1;
     }
 
-    if (dest->dimx != src->dimx || dest->dimy != src->dimy)
+    if (dest->dimx != src->dimx || dest->dimy != src->dimy || x_end > src->dimx || y_end > src->dimy)
     {
         return 1;
     }
 
-    for (unsigned int y = 0; y < src->dimy; y++)
+    if (x_start >= x_end)
+    {
+        return 0;
+    }
+
+    size_t dest_px = framebuf_px_size(dest->format);
+    size_t src_px = framebuf_px_size(src->format);
+    unsigned int n = x_end - x_start;
+
+    // Tiled rows are staged through linear memory, a chunk at a time
+    if (dest->layout != FB_LAYOUT_LINEAR || src->layout != FB_LAYOUT_LINEAR)
+    {
+        tup3 chunk[FB_COPY_CHUNK];
+
+        for (unsigned int y = y_start; y < y_end; y++)
+        {
+            for (unsigned int x = x_start; x < x_end; x += FB_COPY_CHUNK)
+            {
+                unsigned int chunk_end = (x_end - x < FB_COPY_CHUNK) ? x_end : x + FB_COPY_CHUNK;
+
+                framebuf_read_row(src, x, chunk_end, y, chunk);
+                framebuf_write_row(dest, x, chunk_end, y, chunk);
+            }
+        }
+
+        return 0;
+    }
+
+    for (unsigned int y = y_start; y < y_end; y++)
+    {
+        size_t offset = x_start + (size_t) y * src->dimx;
+        char *dest_row = (char *) dest->data + offset * dest_px;
+        char *src_row = (char *) src->data + offset * src_px;
+
+        // Rows are copied whole, or converted a row at a time
+        if (dest->format == src->format)
+        {
+            memcpy(dest_row, src_row, src_px * n);
+        }
+        else if (dest->format == FB_FORMAT_TUP3)
+        {
+            framebuf_unpack_row(src->format, (tup3 *) dest_row, src_row, n);
+        }
+        else if (src->format == FB_FORMAT_TUP3)
+        {
+            framebuf_pack_row(dest->format, dest_row, (tup3 *) src_row, n);
+        }
+        else
+        {
+            for (unsigned int x = x_start; x < x_end; x++)
+            {
+                tup3 px = framebuf_get(src, x, y);
+
+                framebuf_set(dest, x, y, &px);
+            }
+        }
+    }
+
+    return 0;
+}
+
+
+int framebuf_read_row(framebuf *fb, unsigned int x_start, unsigned int x_end, unsigned int y, tup3 *dest)
+{
+    if (x_end > fb->dimx || y >= fb->dimy)
+    {
+        return -1;
+    }
+
+    size_t px_size = framebuf_px_size(fb->format);
+
+    // Each run of pixels within a tile row is contiguous (or the whole row, if linear)
+    for (unsigned int x = x_start; x < x_end;)
+    {
+        unsigned int n = row_run(fb, x, x_end);
+
+        framebuf_unpack_row(fb->format, dest, (char *) fb->data + framebuf_index(fb, x, y) * px_size, n);
+
+        dest += n;
+        x += n;
+    }
+
+    return 0;
+}
+
+
+int framebuf_write_row(framebuf *fb, unsigned int x_start, unsigned int x_end, unsigned int y, tup3 *src)
+{
+    if (x_end > fb->dimx || y >= fb->dimy)
+    {
+        return -1;
+    }
+
+    size_t px_size = framebuf_px_size(fb->format);
+
+    for (unsigned int x = x_start; x < x_end;)
+    {
+        unsigned int n = row_run(fb, x, x_end);
+
+        framebuf_pack_row(fb->format, (char *) fb->data + framebuf_index(fb, x, y) * px_size, src, n);
+
+        src += n;
+        x += n;
+    }
+
+    return 0;
+}
+
+
+// < Pixel Conversion >
+
+void framebuf_pack_row(fb_format format, void *dest, tup3 *src, unsigned int n)
+{
+    // A loop per format, so that each is vectorised across pixels
+    switch (format)
+    {
+        case FB_FORMAT_RGBA8:
+            for (unsigned int i = 0; i < n; i++)
+            {
+                ((fb_rgba8 *) dest)[i] = fb_pack_rgba8(src + i);
+            }
+            break;
+
+        case FB_FORMAT_RGBA16F:
+            for (unsigned int i = 0; i < n; i++)
+            {
+                ((fb_rgba16f *) dest)[i] = fb_pack_rgba16f(src + i);
+            }
+            break;
+
+        case FB_FORMAT_RGB32F:
+            for (unsigned int i = 0; i < n; i++)
+            {
+                ((fb_rgb32f *) dest)[i] = fb_pack_rgb32f(src + i);
+            }
+            break;
+
+        default:
+            memcpy(dest, src, sizeof(tup3) * n);
+            break;
+    }
+}
+
+
+void framebuf_unpack_row(fb_format format, tup3 *dest, void *src, unsigned int n)
+{
+    switch (format)
+    {
+        case FB_FORMAT_RGBA8:
+            for (unsigned int i = 0; i < n; i++)
+            {
+                dest[i] = fb_unpack_rgba8(((fb_rgba8 *) src)[i]);
+            }
+            break;
+
+        case FB_FORMAT_RGBA16F:
+            for (unsigned int i = 0; i < n; i++)
+            {
+                dest[i] = fb_unpack_rgba16f(((fb_rgba16f *) src)[i]);
+            }
+            break;
+
+        case FB_FORMAT_RGB32F:
+            for (unsigned int i = 0; i < n; i++)
+            {
+                dest[i] = fb_unpack_rgb32f(((fb_rgb32f *) src)[i]);
+            }
+            break;
+
+        default:
+            memcpy(dest, src, sizeof(tup3) * n);
+            break;
+    }
+}
+
+
+// < Gathering >
+
+void framebuf_gather_row(framebuf *fb, int x, int y, unsigned int n, fb_address mode, tup3 *dest)
+{
+    unsigned int row = fb_addr(y, fb->dimy, mode);
+
+    // The run of pixels within the framebuf, relative to x
+    long long in_start = (x < 0) ? -(long long) x : 0;
+    long long in_end = (long long) fb->dimx - x;
+
+    in_start = (in_start > n) ? n : in_start;
+    in_end = (in_end > n) ? n : ((in_end < in_start) ? in_start : in_end);
+
+    for (long long i = 0; i < in_start; i++)
+    {
+        dest[i] = framebuf_get(fb, fb_addr(x + i, fb->dimx, mode), row);
+    }
+
+    if (in_end > in_start)
+    {
+        framebuf_read_row(fb, x + in_start, x + in_end, row, dest + in_start);
+    }
+
+    for (long long i = in_end; i < n; i++)
+    {
+        dest[i] = framebuf_get(fb, fb_addr(x + i, fb->dimx, mode), row);
+    }
+}
+
+
+void framebuf_gather_col(framebuf *fb, int x, int y, unsigned int n, fb_address mode, tup3 *dest)
+{
+    unsigned int col = fb_addr(x, fb->dimx, mode);
+
+    long long in_start = (y < 0) ? -(long long) y : 0;
+    long long in_end = (long long) fb->dimy - y;
+
+    in_start = (in_start > n) ? n : in_start;
+    in_end = (in_end > n) ? n : ((in_end < in_start) ? in_start : in_end);
+
+    for (long long i = 0; i < in_start; i++)
+    {
+        dest[i] = framebuf_get(fb, col, fb_addr(y + i, fb->dimy, mode));
+    }
+
+    for (long long i = in_start; i < in_end; i++)
+    {
+        dest[i] = framebuf_get(fb, col, y + i);
+    }
+
+    for (long long i = in_end; i < n; i++)
+    {
+        dest[i] = framebuf_get(fb, col, fb_addr(y + i, fb->dimy, mode));
+    }
+}
+
+
+void framebuf_gather_rect(framebuf *fb, int x, int y, unsigned int w, unsigned int h, fb_address mode,
+                          tup3 *dest)
+{
+    for (unsigned int r = 0; r < h; r++)
+    {
+        framebuf_gather_row(fb, x, y + (int) r, w, mode, dest + (size_t) r * w);
+    }
+}
+
+
+// < Framebuffer Sorting >
+
+int framebuf_sort_lanes(framebuf *fb, sort_axis axis, unsigned int segment_len, pixel_key key,
+                        unsigned int lane_start, unsigned int lane_end)
+{
+    // Lanes are rows or columns - a pixel is (lane position, lane) or (lane, lane position)
+    int rows = (axis == SORT_AXIS_ROWS);
+    unsigned int lane_len = rows ? fb->dimx : fb->dimy;
+    unsigned int n_lanes = rows ? fb->dimy : fb->dimx;
+
+    if (segment_len == 0 || segment_len > lane_len)
+    {
+        segment_len = lane_len;
+    }
+
+    if (lane_end > n_lanes)
+    {
+        lane_end = n_lanes;
+    }
+
+    if (key == NULL)
+    {
+        key = pixel_luminance;
+    }
+
+    if (segment_len == 0 || lane_start >= lane_end)
     {
-        for (unsigned int x = 0; x < src->dimx; x++)
+        return 0;
+    }
+
+    // Each segment is gathered (and converted from the framebuf's format), so that columns
+    // are sorted in contiguous memory
+    // Pixels come first in the block, keeping them aligned
+    tup3 *px = malloc((sizeof(tup3) + sizeof(uint16_t)) * 2 * segment_len);
+
+    if (px == NULL)
+    {
+        return -1;
+    }
+
+    tup3 *tmp_px = px + segment_len;
+    uint16_t *keys = (uint16_t *) (tmp_px + segment_len);
+    uint16_t *tmp_keys = keys + segment_len;
+
+    for (unsigned int lane = lane_start; lane < lane_end; lane++)
+    {
+        for (unsigned int seg = 0; seg < lane_len; seg += segment_len)
         {
-            dest->buf[x + y * src->dimx] = src->buf[x + y * src->dimx];
+            unsigned int n = (lane_len - seg < segment_len) ? lane_len - seg : segment_len;
+
+            for (unsigned int i = 0; i < n; i++)
+            {
+                px[i] = rows ? framebuf_get(fb, seg + i, lane) : framebuf_get(fb, lane, seg + i);
+                keys[i] = quantise_key(key(px + i));
+            }
+
+            sort_keyed(keys, px, n, tmp_keys, tmp_px);
+
+            for (unsigned int i = 0; i < n; i++)
+            {
+                if (rows)
+                {
+                    framebuf_set(fb, seg + i, lane, px + i);
+                }
+                else
+                {
+                    framebuf_set(fb, lane, seg + i, px + i);
+                }
+            }
         }
     }
 
+    free(px);
+
     return 0;
 }
+
+
+int framebuf_sort_segments(framebuf *fb, sort_axis axis, unsigned int segment_len, pixel_key key)
+{
+    unsigned int n_lanes = (axis == SORT_AXIS_ROWS) ? fb->dimy : fb->dimx;
+
+    return framebuf_sort_lanes(fb, axis, segment_len, key, 0, n_lanes);
+}
+
+
+float pixel_luminance(tup3 *px)
+{
+    return 0.2126f * px->x + 0.7152f * px->y + 0.0722f * px->z;
+}
+
+
+float pixel_hue(tup3 *px)
+{
+    float max = fmaxf(px->x, fmaxf(px->y, px->z));
+    float min = fminf(px->x, fminf(px->y, px->z));
+    float chroma = max - min;
+
+    if (chroma < TUP_EPSILON)
+    {
+        return 0.0f;
+    }
+
+    float hue;
+
+    if (max == px->x)
+    {
+        hue = fmodf((px->y - px->z) / chroma + 6.0f, 6.0f);
+    }
+    else if (max == px->y)
+    {
+        hue = (px->z - px->x) / chroma + 2.0f;
+    }
+    else
+    {
+        hue = (px->x - px->y) / chroma + 4.0f;
+    }
+
+    return hue / 6.0f;
+}
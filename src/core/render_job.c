@@ -1,5 +1,165 @@
 #include "core/render_job.h"
 
+#include <sched.h>
+
+// -----===[ Internal Functions ]===-----
+
+#define DEQUE_FRONT(range) ((unsigned int) ((range) >> 32))
+#define DEQUE_BACK(range) ((unsigned int) ((range) & 0xffffffffu))
+#define DEQUE_RANGE(front, back) ((((unsigned long long) (front)) << 32) | (back))
+
+// The next index is kept in the lower bits, so that claiming is a single increment
+#define CLAIM_LIMIT(state) ((unsigned int) ((state) >> 32))
+#define CLAIM_NEXT(state) ((unsigned int) ((state) & 0xffffffffu))
+#define CLAIM_STATE(next, limit) ((((unsigned long long) (limit)) << 32) | (next))
+
+#define WAVE_FRAME(entry) ((unsigned long) ((entry) >> 32))
+#define WAVE_JOB(entry) ((unsigned int) ((entry) & 0xffffffffu))
+#define WAVE_ENTRY(frame, job) ((((unsigned long long) (frame)) << 32) | (job))
+
+
+/*
+ * Determines whether a job lies within the given radius of another job
+ */
+static inline int job_near(render_job *a, render_job *b, unsigned int radius)
+{
+    return (unsigned long long) b->x_start < (unsigned long long) a->x_end + radius
+           && (unsigned long long) a->x_start < (unsigned long long) b->x_end + radius
+           && (unsigned long long) b->y_start < (unsigned long long) a->y_end + radius
+           && (unsigned long long) a->y_start < (unsigned long long) b->y_end + radius;
+}
+
+
+/*
+ * Meets one dependency of a job in the given frame, returning 1 if that was its last
+ *
+ * Once met, the job's counter is reset for the frame two after (which cannot start before this
+ * job does, so cannot have met any of its dependencies yet)
+ */
+static inline int wave_resolve(job_wavefront *jw, unsigned int idx, unsigned long frame)
+{
+    atomic_uint *pending = jw->pending + 2 * idx + frame % 2;
+
+    if (atomic_fetch_sub(pending, 1) != 1)
+    {
+        return 0;
+    }
+
+    atomic_store(pending, jw->dep_start[idx + 1] - jw->dep_start[idx] + 1);
+
+    return 1;
+}
+
+
+/*
+ * Adds a job to the ring of ready jobs (the ready lock must be held)
+ */
+static inline void wave_push(job_wavefront *jw, unsigned int idx, unsigned long frame)
+{
+    jw->ready[(jw->ready_head + jw->ready_count) % (2 * jw->n_jobs)] = WAVE_ENTRY(frame, idx);
+    jw->ready_count++;
+}
+
+
+/*
+ * Takes the front (or back) index of a deque, returning 0 on success and -1 if empty
+ *
+ * The owner takes from the front, so that it works through its run in order
+ * Thieves take from the back, as far as possible from where the owner is working
+ */
+static inline int deque_take(job_deque *dq, int from_back, unsigned int *idx)
+{
+    unsigned long long range = atomic_load(&(dq->range));
+    unsigned long long new_range;
+    unsigned int front, back;
+
+    do
+    {
+        front = DEQUE_FRONT(range);
+        back = DEQUE_BACK(range);
+
+        if (front >= back)
+        {
+            return -1;
+        }
+
+        new_range = from_back ? DEQUE_RANGE(front, back - 1) : DEQUE_RANGE(front + 1, back);
+    }
+    while (!atomic_compare_exchange_weak(&(dq->range), &range, new_range));
+
+    *idx = from_back ? back - 1 : front;
+
+    return 0;
+}
+
+
+/*
+ * Converts a distance along a Morton curve into grid coordinates
+ */
+static inline void morton_d2xy(unsigned int d, unsigned int *x, unsigned int *y)
+{
+    *x = 0;
+    *y = 0;
+
+    // De-interleave the bits of d
+    for (unsigned int bit = 0; (d >> (2 * bit)) != 0; bit++)
+    {
+        *x |= ((d >> (2 * bit)) & 1) << bit;
+        *y |= ((d >> (2 * bit + 1)) & 1) << bit;
+    }
+}
+
+
+/*
+ * Converts a distance along a Hilbert curve into grid coordinates,
+ * for a grid of side n (a power of two)
+ */
+static inline void hilbert_d2xy(unsigned int n, unsigned int d, unsigned int *x, unsigned int *y)
+{
+    unsigned int rx, ry, tmp;
+
+    *x = 0;
+    *y = 0;
+
+    for (unsigned int s = 1; s < n; s *= 2)
+    {
+        rx = 1 & (d / 2);
+        ry = 1 & (d ^ rx);
+
+        // Rotate the quadrant
+        if (ry == 0)
+        {
+            if (rx == 1)
+            {
+                *x = s - 1 - *x;
+                *y = s - 1 - *y;
+            }
+
+            tmp = *x;
+            *x = *y;
+            *y = tmp;
+        }
+
+        *x += s * rx;
+        *y += s * ry;
+        d /= 4;
+    }
+}
+
+
+static inline void tile_job(render_job *job, unsigned int tx, unsigned int ty, unsigned int dimx,
+                            unsigned int dimy, unsigned int tile_w, unsigned int tile_h)
+{
+    job->x_start = tx * tile_w;
+    job->x_end = job->x_start + tile_w < dimx ? job->x_start + tile_w : dimx;
+    job->y_start = ty * tile_h;
+    job->y_end = job->y_start + tile_h < dimy ? job->y_start + tile_h : dimy;
+    job->quit = 0;
+    job->in_arena = 1;
+    job->next = NULL;
+}
+
+
 // -----===[ Job Queue Functions ]===-----
 
 job_queue *jobq_init(void)
@@ -86,6 +246,43 @@ void jobq_enqueue(job_queue *jq, render_job *job)
 }
 
 
+void jobq_enqueue_batch(job_queue *jq, render_job *jobs, unsigned int n)
+{
+    if (n == 0)
+    {
+        return;
+    }
+
+    // Link the batch together before taking the lock
+    for (unsigned int i = 0; i + 1 < n; i++)
+    {
+        jobs[i].next = jobs + i + 1;
+    }
+
+    jobs[n - 1].next = NULL;
+
+    pthread_mutex_lock(&(jq->access_lock));
+
+    pthread_mutex_lock(&(jq->jobc_lock));
+    jq->jobs_outstanding += n;
+    pthread_mutex_unlock(&(jq->jobc_lock));
+
+    if (jq->head == NULL)
+    {
+        jq->head = jobs;
+    }
+    else
+    {
+        jq->tail->next = jobs;
+    }
+
+    jq->tail = jobs + n - 1;
+
+    pthread_cond_broadcast(&(jq->is_nonempty));
+    pthread_mutex_unlock(&(jq->access_lock));
+}
+
+
 render_job *jobq_dequeue(job_queue *jq)
 {
     render_job *job;
@@ -138,55 +335,1039 @@ void jobq_wait_complete(job_queue *jq)
 }
 
 
-// -----===[ Job Functions ]===-----
+// -----===[ Job Dispenser Functions ]===-----
 
-render_job *job_init(unsigned int x_start, unsigned int x_end, unsigned int y_start, unsigned int y_end)
+job_dispenser *jobd_init(unsigned int n_jobs)
 {
-    render_job *new_job;
+    job_dispenser *new_jd;
 
-    new_job = malloc(sizeof(render_job));
+    new_jd = malloc(sizeof(job_dispenser));
 
-    if (new_job == NULL)
+    if (new_jd == NULL)
     {
-        return NULL;
+        goto error_exit;
     }
 
-    new_job->x_start = x_start;
-    new_job->x_end = x_end;
-    new_job->y_start = y_start;
-    new_job->y_end = y_end;
-    new_job->quit = 0;
+    new_jd->jobs = malloc(sizeof(render_job) * n_jobs);
 
-    new_job->next = NULL;
+    if (new_jd->jobs == NULL)
+    {
+        goto error_free;
+    }
 
-    return new_job;
+    new_jd->n_jobs = n_jobs;
+    new_jd->deques = NULL;
+    new_jd->n_deques = 0;
+    new_jd->barrier = NULL;
+    atomic_init(&(new_jd->next), CLAIM_STATE(n_jobs, n_jobs));
+    atomic_init(&(new_jd->remaining), 0);
+    new_jd->generation = 0;
+    new_jd->quit = 0;
+
+    if (pthread_cond_init(&(new_jd->frame_start), NULL))
+    {
+        goto error_free_jobs;
+    }
+
+    if (pthread_cond_init(&(new_jd->frame_done), NULL))
+    {
+        goto error_destroy_cond;
+    }
+
+    pthread_mutex_init(&(new_jd->frame_lock), NULL);
+
+    return new_jd;
+
+error_destroy_cond:
+    pthread_cond_destroy(&(new_jd->frame_start));
+error_free_jobs:
+    free(new_jd->jobs);
+error_free:
+    free(new_jd);
+error_exit:
+    return NULL;
 }
 
 
-render_job *job_quit_init(void)
+int jobd_enable_stealing(job_dispenser *jd, unsigned int n_workers)
 {
-    render_job *new_job;
+    job_deque *deques;
 
-    new_job = malloc(sizeof(render_job));
+    deques = aligned_alloc(_Alignof(job_deque), sizeof(job_deque) * n_workers);
 
-    if (new_job == NULL)
+    if (deques == NULL)
+    {
+        return -1;
+    }
+
+    // Start with every deque empty
+    for (unsigned int i = 0; i < n_workers; i++)
+    {
+        atomic_init(&(deques[i].range), DEQUE_RANGE(0, 0));
+    }
+
+    jd->deques = deques;
+    jd->n_deques = n_workers;
+
+    return 0;
+}
+
+
+int jobd_enable_barrier(job_dispenser *jd, unsigned int n_participants)
+{
+    if ((jd->barrier = fbar_init(n_participants)) == NULL)
+    {
+        return -1;
+    }
+
+    return 0;
+}
+
+
+void jobd_delete(job_dispenser *jd)
+{
+    pthread_mutex_destroy(&(jd->frame_lock));
+
+    pthread_cond_destroy(&(jd->frame_start));
+    pthread_cond_destroy(&(jd->frame_done));
+
+    if (jd->barrier != NULL)
+    {
+        fbar_delete(jd->barrier);
+    }
+
+    free(jd->deques);
+    free(jd->jobs);
+    free(jd);
+}
+
+
+void jobd_start_frame(job_dispenser *jd)
+{
+    // With a barrier, every worker is waiting on it - so no lock is needed to reset
+    if (jd->barrier == NULL)
+    {
+        pthread_mutex_lock(&(jd->frame_lock));
+    }
+
+    atomic_store(&(jd->remaining), jd->n_jobs);
+    atomic_store(&(jd->next), CLAIM_STATE(0, jd->n_jobs));
+    jd->generation++;
+
+    // Give each deque a contiguous run of jobs
+    // All deques are empty at this point, so a late thief cannot take a stale job
+    for (unsigned int i = 0; i < jd->n_deques; i++)
+    {
+        unsigned int run_start = (unsigned long long) jd->n_jobs * i / jd->n_deques;
+        unsigned int run_end = (unsigned long long) jd->n_jobs * (i + 1) / jd->n_deques;
+
+        atomic_store(&(jd->deques[i].range), DEQUE_RANGE(run_start, run_end));
+    }
+
+    if (jd->barrier != NULL)
+    {
+        fbar_wait(jd->barrier);
+        return;
+    }
+
+    pthread_cond_broadcast(&(jd->frame_start));
+    pthread_mutex_unlock(&(jd->frame_lock));
+}
+
+
+int jobd_wait_frame(job_dispenser *jd, unsigned long *seen)
+{
+    int started;
+
+    if (jd->barrier != NULL)
+    {
+        fbar_wait(jd->barrier);
+
+        return !jd->quit;
+    }
+
+    pthread_mutex_lock(&(jd->frame_lock));
+
+    while (!jd->quit && jd->generation == *seen)
+    {
+        pthread_cond_wait(&(jd->frame_start), &(jd->frame_lock));
+    }
+
+    started = !jd->quit;
+    *seen = jd->generation;
+
+    pthread_mutex_unlock(&(jd->frame_lock));
+
+    return started;
+}
+
+
+render_job *jobd_claim(job_dispenser *jd)
+{
+    unsigned long long state;
+    unsigned int idx;
+
+    // The number of jobs is read from the same counter, as a late worker may still be claiming
+    // while the jobs of the next frame are described
+    // Once all jobs are claimed, avoid pushing the counter any further
+    state = atomic_load_explicit(&(jd->next), memory_order_acquire);
+
+    if (CLAIM_NEXT(state) >= CLAIM_LIMIT(state))
     {
         return NULL;
     }
 
-    new_job->x_start = 0;
-    new_job->x_end = 0;
-    new_job->y_start = 0;
-    new_job->y_end = 0;
-    new_job->quit = 1;
+    // Acquire, as a late worker may claim a job of the next frame before waiting on it
+    state = atomic_fetch_add_explicit(&(jd->next), 1, memory_order_acquire);
+    idx = CLAIM_NEXT(state);
 
-    new_job->next = NULL;
+    if (idx >= CLAIM_LIMIT(state))
+    {
+        return NULL;
+    }
 
-    return new_job;
+    return jd->jobs + idx;
 }
 
 
-void job_delete(render_job *job)
+render_job *jobd_claim_local(job_dispenser *jd, unsigned int worker, unsigned int *seed)
+{
+    unsigned int idx;
+    unsigned int victim;
+
+    // Prefer the worker's own run of jobs
+    if (!deque_take(jd->deques + worker, 0, &idx))
+    {
+        return jd->jobs + idx;
+    }
+
+    // Pick a random victim (xorshift), and try every other deque from there
+    *seed ^= *seed << 13;
+    *seed ^= *seed >> 17;
+    *seed ^= *seed << 5;
+
+    victim = *seed % jd->n_deques;
+
+    for (unsigned int i = 0; i < jd->n_deques; i++)
+    {
+        unsigned int v = (victim + i) % jd->n_deques;
+
+        if (v != worker && !deque_take(jd->deques + v, 1, &idx))
+        {
+            return jd->jobs + idx;
+        }
+    }
+
+    return NULL;
+}
+
+
+void jobd_report_complete(job_dispenser *jd, unsigned int n_complete)
+{
+    if (jd->barrier != NULL)
+    {
+        fbar_wait(jd->barrier);
+        return;
+    }
+
+    if (n_complete == 0)
+    {
+        return;
+    }
+
+    // Only the thread completing the final job needs to take the lock
+    if (atomic_fetch_sub(&(jd->remaining), n_complete) == n_complete)
+    {
+        pthread_mutex_lock(&(jd->frame_lock));
+        pthread_cond_broadcast(&(jd->frame_done));
+        pthread_mutex_unlock(&(jd->frame_lock));
+    }
+}
+
+
+void jobd_wait_complete(job_dispenser *jd)
+{
+    if (jd->barrier != NULL)
+    {
+        fbar_wait(jd->barrier);
+        return;
+    }
+
+    pthread_mutex_lock(&(jd->frame_lock));
+
+    while (atomic_load(&(jd->remaining)) != 0)
+    {
+        pthread_cond_wait(&(jd->frame_done), &(jd->frame_lock));
+    }
+
+    pthread_mutex_unlock(&(jd->frame_lock));
+}
+
+
+void jobd_quit(job_dispenser *jd)
 {
-    free(job);
+    if (jd->barrier != NULL)
+    {
+        jd->quit = 1;
+
+        fbar_wait(jd->barrier);
+        return;
+    }
+
+    pthread_mutex_lock(&(jd->frame_lock));
+
+    jd->quit = 1;
+
+    pthread_cond_broadcast(&(jd->frame_start));
+    pthread_mutex_unlock(&(jd->frame_lock));
+}
+
+
+// -----===[ Job Wavefront Functions ]===-----
+
+job_wavefront *jobw_init(unsigned int n_jobs)
+{
+    job_wavefront *new_jw;
+
+    new_jw = malloc(sizeof(job_wavefront));
+
+    if (new_jw == NULL)
+    {
+        goto error_exit;
+    }
+
+    new_jw->jobs = malloc(sizeof(render_job) * n_jobs);
+    new_jw->dep_start = malloc(sizeof(unsigned int) * (n_jobs + 1));
+    new_jw->pending = malloc(sizeof(atomic_uint) * 2 * n_jobs);
+    new_jw->ready = malloc(sizeof(unsigned long long) * 2 * n_jobs);
+
+    if (new_jw->jobs == NULL || new_jw->dep_start == NULL || new_jw->pending == NULL || new_jw->ready == NULL)
+    {
+        goto error_free_arrays;
+    }
+
+    new_jw->n_jobs = n_jobs;
+    new_jw->n_frames = 0;
+    new_jw->deps = NULL;
+    atomic_init(&(new_jw->remaining[0]), 0);
+    atomic_init(&(new_jw->remaining[1]), 0);
+    new_jw->ready_head = 0;
+    new_jw->ready_count = 0;
+    new_jw->completed = 0;
+    new_jw->quit = 0;
+
+    for (unsigned int i = 0; i < 2 * n_jobs; i++)
+    {
+        atomic_init(new_jw->pending + i, 0);
+    }
+
+    if (pthread_cond_init(&(new_jw->is_ready), NULL))
+    {
+        goto error_free_arrays;
+    }
+
+    if (pthread_cond_init(&(new_jw->frame_done), NULL))
+    {
+        goto error_destroy_cond;
+    }
+
+    pthread_mutex_init(&(new_jw->ready_lock), NULL);
+
+    return new_jw;
+
+error_destroy_cond:
+    pthread_cond_destroy(&(new_jw->is_ready));
+error_free_arrays:
+    free(new_jw->jobs);
+    free(new_jw->dep_start);
+    free(new_jw->pending);
+    free(new_jw->ready);
+    free(new_jw);
+error_exit:
+    return NULL;
+}
+
+
+void jobw_delete(job_wavefront *jw)
+{
+    pthread_mutex_destroy(&(jw->ready_lock));
+
+    pthread_cond_destroy(&(jw->is_ready));
+    pthread_cond_destroy(&(jw->frame_done));
+
+    free(jw->jobs);
+    free(jw->dep_start);
+    free(jw->deps);
+    free(jw->pending);
+    free(jw->ready);
+    free(jw);
+}
+
+
+int jobw_link(job_wavefront *jw, unsigned int radius)
+{
+    unsigned int n_deps = 0;
+    unsigned int *deps;
+
+    // Count the dependencies of each job, then fill them in
+    for (unsigned int i = 0; i < jw->n_jobs; i++)
+    {
+        jw->dep_start[i] = n_deps;
+
+        for (unsigned int j = 0; j < jw->n_jobs; j++)
+        {
+            n_deps += job_near(jw->jobs + i, jw->jobs + j, radius);
+        }
+    }
+
+    jw->dep_start[jw->n_jobs] = n_deps;
+
+    if ((deps = malloc(sizeof(unsigned int) * n_deps)) == NULL)
+    {
+        return -1;
+    }
+
+    for (unsigned int i = 0; i < jw->n_jobs; i++)
+    {
+        unsigned int k = jw->dep_start[i];
+
+        for (unsigned int j = 0; j < jw->n_jobs; j++)
+        {
+            if (job_near(jw->jobs + i, jw->jobs + j, radius))
+            {
+                deps[k++] = j;
+            }
+        }
+    }
+
+    free(jw->deps);
+    jw->deps = deps;
+
+    return 0;
+}
+
+
+void jobw_start(job_wavefront *jw, unsigned long n_frames)
+{
+    pthread_mutex_lock(&(jw->ready_lock));
+
+    jw->n_frames = n_frames;
+    jw->completed = 0;
+    jw->ready_head = 0;
+    jw->ready_count = 0;
+
+    atomic_store(&(jw->remaining[0]), jw->n_jobs);
+    atomic_store(&(jw->remaining[1]), jw->n_jobs);
+
+    // The second frame waits only on the first, while later frames also wait to be released
+    for (unsigned int i = 0; i < jw->n_jobs; i++)
+    {
+        unsigned int n_deps = jw->dep_start[i + 1] - jw->dep_start[i];
+
+        atomic_store(jw->pending + 2 * i, n_deps + 1);
+        atomic_store(jw->pending + 2 * i + 1, n_deps);
+
+        wave_push(jw, i, 0);
+    }
+
+    pthread_cond_broadcast(&(jw->is_ready));
+    pthread_mutex_unlock(&(jw->ready_lock));
+}
+
+
+render_job *jobw_claim(job_wavefront *jw, unsigned long *frame)
+{
+    unsigned long long entry;
+
+    pthread_mutex_lock(&(jw->ready_lock));
+
+    while (!jw->quit && jw->ready_count == 0)
+    {
+        pthread_cond_wait(&(jw->is_ready), &(jw->ready_lock));
+    }
+
+    if (jw->ready_count == 0)
+    {
+        pthread_mutex_unlock(&(jw->ready_lock));
+
+        return NULL;
+    }
+
+    entry = jw->ready[jw->ready_head];
+
+    jw->ready_head = (jw->ready_head + 1) % (2 * jw->n_jobs);
+    jw->ready_count--;
+
+    pthread_mutex_unlock(&(jw->ready_lock));
+
+    *frame = WAVE_FRAME(entry);
+
+    return jw->jobs + WAVE_JOB(entry);
+}
+
+
+void jobw_report_complete(job_wavefront *jw, render_job *job, unsigned long frame)
+{
+    unsigned int idx = job - jw->jobs;
+
+    // Count the job before any job of the next frame can start from it, so that the next frame
+    // never completes (and this frame is never released) before this frame is counted as complete
+    // Only the thread completing the final job of the frame needs to signal it
+    if (atomic_fetch_sub(&(jw->remaining[frame % 2]), 1) == 1)
+    {
+        pthread_mutex_lock(&(jw->ready_lock));
+
+        // The next frame may already have been counted, if this thread was slow to take the lock
+        if (jw->completed < frame + 1)
+        {
+            jw->completed = frame + 1;
+        }
+
+        pthread_cond_broadcast(&(jw->frame_done));
+        pthread_mutex_unlock(&(jw->ready_lock));
+    }
+
+    // The jobs of the next frame around this one may now be ready
+    if (frame + 1 < jw->n_frames)
+    {
+        for (unsigned int k = jw->dep_start[idx]; k < jw->dep_start[idx + 1]; k++)
+        {
+            if (wave_resolve(jw, jw->deps[k], frame + 1))
+            {
+                pthread_mutex_lock(&(jw->ready_lock));
+
+                wave_push(jw, jw->deps[k], frame + 1);
+
+                pthread_cond_signal(&(jw->is_ready));
+                pthread_mutex_unlock(&(jw->ready_lock));
+            }
+        }
+    }
+}
+
+
+void jobw_wait_frame(job_wavefront *jw, unsigned long frame)
+{
+    pthread_mutex_lock(&(jw->ready_lock));
+
+    while (jw->completed <= frame)
+    {
+        pthread_cond_wait(&(jw->frame_done), &(jw->ready_lock));
+    }
+
+    pthread_mutex_unlock(&(jw->ready_lock));
+}
+
+
+void jobw_release_frame(job_wavefront *jw, unsigned long frame)
+{
+    if (frame + 2 >= jw->n_frames)
+    {
+        return;
+    }
+
+    // The frame is complete, so its counter is free for the frame that reuses its framebuffer
+    atomic_store(&(jw->remaining[frame % 2]), jw->n_jobs);
+
+    pthread_mutex_lock(&(jw->ready_lock));
+
+    for (unsigned int i = 0; i < jw->n_jobs; i++)
+    {
+        if (wave_resolve(jw, i, frame + 2))
+        {
+            wave_push(jw, i, frame + 2);
+        }
+    }
+
+    pthread_cond_broadcast(&(jw->is_ready));
+    pthread_mutex_unlock(&(jw->ready_lock));
+}
+
+
+void jobw_quit(job_wavefront *jw)
+{
+    pthread_mutex_lock(&(jw->ready_lock));
+
+    jw->quit = 1;
+
+    pthread_cond_broadcast(&(jw->is_ready));
+    pthread_mutex_unlock(&(jw->ready_lock));
+}
+
+
+// -----===[ Frame Barrier Functions ]===-----
+
+frame_barrier *fbar_init(unsigned int n_threads)
+{
+    frame_barrier *new_fb;
+
+    new_fb = malloc(sizeof(frame_barrier));
+
+    if (new_fb == NULL)
+    {
+        return NULL;
+    }
+
+    atomic_init(&(new_fb->n_threads), n_threads);
+    atomic_init(&(new_fb->arrived), 0);
+    atomic_init(&(new_fb->phase), 0);
+    atomic_init(&(new_fb->parked), 0);
+
+    if (pthread_cond_init(&(new_fb->is_passed), NULL))
+    {
+        free(new_fb);
+        return NULL;
+    }
+
+    pthread_mutex_init(&(new_fb->park_lock), NULL);
+
+    return new_fb;
+}
+
+
+void fbar_delete(frame_barrier *fb)
+{
+    pthread_mutex_destroy(&(fb->park_lock));
+    pthread_cond_destroy(&(fb->is_passed));
+
+    free(fb);
+}
+
+
+int fbar_wait(frame_barrier *fb)
+{
+    unsigned int phase = atomic_load(&(fb->phase));
+
+    // The last thread to arrive resets the barrier and passes it
+    if (atomic_fetch_add(&(fb->arrived), 1) + 1 == atomic_load(&(fb->n_threads)))
+    {
+        atomic_store(&(fb->arrived), 0);
+        atomic_store(&(fb->phase), phase + 1);
+
+        // Only take the lock if some thread has gone to sleep
+        if (atomic_load(&(fb->parked)) != 0)
+        {
+            pthread_mutex_lock(&(fb->park_lock));
+            pthread_cond_broadcast(&(fb->is_passed));
+            pthread_mutex_unlock(&(fb->park_lock));
+        }
+
+        return 1;
+    }
+
+    // Spin for a while, in case the other threads are close behind
+    for (unsigned int i = 0; i < FRAME_BARRIER_SPIN; i++)
+    {
+        if (atomic_load(&(fb->phase)) != phase)
+        {
+            return 0;
+        }
+
+#if defined(__x86_64__) || defined(__i386__)
+        __builtin_ia32_pause();
+#elif defined(__aarch64__)
+        __asm__ __volatile__("yield");
+#else
+        sched_yield();
+#endif
+    }
+
+    // Then sleep until the barrier is passed
+    pthread_mutex_lock(&(fb->park_lock));
+    atomic_fetch_add(&(fb->parked), 1);
+
+    while (atomic_load(&(fb->phase)) == phase)
+    {
+        pthread_cond_wait(&(fb->is_passed), &(fb->park_lock));
+    }
+
+    atomic_fetch_sub(&(fb->parked), 1);
+    pthread_mutex_unlock(&(fb->park_lock));
+
+    return 0;
+}
+
+
+void fbar_resize(frame_barrier *fb, unsigned int n_threads)
+{
+    atomic_store(&(fb->n_threads), n_threads);
+}
+
+
+// -----===[ Job Functions ]===-----
+
+render_job *job_init(unsigned int x_start, unsigned int x_end, unsigned int y_start, unsigned int y_end)
+{
+    render_job *new_job;
+
+    new_job = malloc(sizeof(render_job));
+
+    if (new_job == NULL)
+    {
+        return NULL;
+    }
+
+    new_job->x_start = x_start;
+    new_job->x_end = x_end;
+    new_job->y_start = y_start;
+    new_job->y_end = y_end;
+    new_job->quit = 0;
+    new_job->in_arena = 0;
+
+    new_job->next = NULL;
+
+    return new_job;
+}
+
+
+render_job *job_quit_init(void)
+{
+    render_job *new_job;
+
+    new_job = malloc(sizeof(render_job));
+
+    if (new_job == NULL)
+    {
+        return NULL;
+    }
+
+    new_job->x_start = 0;
+    new_job->x_end = 0;
+    new_job->y_start = 0;
+    new_job->y_end = 0;
+    new_job->quit = 1;
+    new_job->in_arena = 0;
+
+    new_job->next = NULL;
+
+    return new_job;
+}
+
+
+void job_delete(render_job *job)
+{
+    if (!job->in_arena)
+    {
+        free(job);
+    }
+}
+
+
+void job_plan_quit(render_job *jobs, unsigned int n)
+{
+    for (unsigned int i = 0; i < n; i++)
+    {
+        jobs[i].x_start = 0;
+        jobs[i].x_end = 0;
+        jobs[i].y_start = 0;
+        jobs[i].y_end = 0;
+        jobs[i].quit = 1;
+        jobs[i].in_arena = 1;
+        jobs[i].next = NULL;
+    }
+}
+
+
+unsigned int job_plan_bands(render_job *jobs, unsigned int max_jobs, unsigned int dimx, unsigned int dimy)
+{
+    // Take the ceiling of the division
+    unsigned int job_ysize = dimy / max_jobs + (dimy % max_jobs != 0);
+
+    unsigned int remaining_y = dimy;
+    unsigned int job_n = 0;
+
+    while (remaining_y)
+    {
+        unsigned int actual_ysize = job_ysize;
+
+        if (actual_ysize > remaining_y)
+        {
+            actual_ysize = remaining_y;
+        }
+
+        jobs[job_n].x_start = 0;
+        jobs[job_n].x_end = dimx;
+        jobs[job_n].y_start = job_ysize * job_n;
+        jobs[job_n].y_end = job_ysize * job_n + actual_ysize;
+        jobs[job_n].quit = 0;
+        jobs[job_n].in_arena = 1;
+        jobs[job_n].next = NULL;
+
+        remaining_y -= actual_ysize;
+        job_n++;
+    }
+
+    return job_n;
+}
+
+
+unsigned int job_plan_group_bands(render_job *jobs, unsigned int max_jobs, unsigned int dimx,
+                                  unsigned int dimy, unsigned int group_h)
+{
+    // Split the rows of groups into bands, then scale them back up to rows of pixels
+    unsigned int group_rows = dimy / group_h + (dimy % group_h != 0);
+    unsigned int job_n = job_plan_bands(jobs, max_jobs, dimx, group_rows);
+
+    for (unsigned int i = 0; i < job_n; i++)
+    {
+        jobs[i].y_start *= group_h;
+        jobs[i].y_end *= group_h;
+
+        if (jobs[i].y_end > dimy)
+        {
+            jobs[i].y_end = dimy;
+        }
+    }
+
+    return job_n;
+}
+
+
+unsigned int job_plan_tile_count(unsigned int dimx, unsigned int dimy, unsigned int tile_w, unsigned int tile_h)
+{
+    // Take the ceiling of each division
+    unsigned int tiles_x = dimx / tile_w + (dimx % tile_w != 0);
+    unsigned int tiles_y = dimy / tile_h + (dimy % tile_h != 0);
+
+    return tiles_x * tiles_y;
+}
+
+
+unsigned int job_plan_tiles(render_job *jobs, unsigned int dimx, unsigned int dimy,
+                            unsigned int tile_w, unsigned int tile_h, tile_order order)
+{
+    unsigned int tiles_x = dimx / tile_w + (dimx % tile_w != 0);
+    unsigned int tiles_y = dimy / tile_h + (dimy % tile_h != 0);
+    unsigned int job_n = 0;
+
+    if (order == TILE_ORDER_ROW)
+    {
+        for (unsigned int ty = 0; ty < tiles_y; ty++)
+        {
+            for (unsigned int tx = 0; tx < tiles_x; tx++)
+            {
+                tile_job(jobs + job_n++, tx, ty, dimx, dimy, tile_w, tile_h);
+            }
+        }
+
+        return job_n;
+    }
+
+    // Walk the curve over the enclosing power of two square, skipping tiles outside the frame
+    unsigned int side = 1;
+
+    while (side < tiles_x || side < tiles_y)
+    {
+        side *= 2;
+    }
+
+    for (unsigned long long d = 0; d < (unsigned long long) side * side && job_n < tiles_x * tiles_y; d++)
+    {
+        unsigned int tx, ty;
+
+        if (order == TILE_ORDER_HILBERT)
+        {
+            hilbert_d2xy(side, d, &tx, &ty);
+        }
+        else
+        {
+            morton_d2xy(d, &tx, &ty);
+        }
+
+        if (tx < tiles_x && ty < tiles_y)
+        {
+            tile_job(jobs + job_n++, tx, ty, dimx, dimy, tile_w, tile_h);
+        }
+    }
+
+    return job_n;
+}
+
+
+// -----===[ Cost Map Functions ]===-----
+
+job_costmap *costmap_init(unsigned int dimx, unsigned int dimy, unsigned int cell_w, unsigned int cell_h)
+{
+    job_costmap *new_cm;
+
+    new_cm = malloc(sizeof(job_costmap));
+
+    if (new_cm == NULL)
+    {
+        return NULL;
+    }
+
+    new_cm->dimx = dimx;
+    new_cm->dimy = dimy;
+    new_cm->cell_w = cell_w;
+    new_cm->cell_h = cell_h;
+
+    // Take the ceiling of each division
+    new_cm->cells_x = dimx / cell_w + (dimx % cell_w != 0);
+    new_cm->cells_y = dimy / cell_h + (dimy % cell_h != 0);
+
+    new_cm->cost = calloc(new_cm->cells_x * new_cm->cells_y, sizeof(float));
+
+    if (new_cm->cost == NULL)
+    {
+        free(new_cm);
+        return NULL;
+    }
+
+    return new_cm;
+}
+
+
+void costmap_delete(job_costmap *cm)
+{
+    free(cm->cost);
+    free(cm);
+}
+
+
+void costmap_record(job_costmap *cm, render_job *job, unsigned long long elapsed_ns)
+{
+    unsigned int cx_start = job->x_start / cm->cell_w;
+    unsigned int cy_start = job->y_start / cm->cell_h;
+    unsigned int cx_end = job->x_end / cm->cell_w + (job->x_end % cm->cell_w != 0);
+    unsigned int cy_end = job->y_end / cm->cell_h + (job->y_end % cm->cell_h != 0);
+
+    float cell_cost = (float) elapsed_ns / ((cx_end - cx_start) * (cy_end - cy_start));
+
+    for (unsigned int cy = cy_start; cy < cy_end; cy++)
+    {
+        for (unsigned int cx = cx_start; cx < cx_end; cx++)
+        {
+            cm->cost[cx + cy * cm->cells_x] = cell_cost;
+        }
+    }
+}
+
+
+double costmap_job_cost(job_costmap *cm, render_job *job)
+{
+    unsigned int cx_start = job->x_start / cm->cell_w;
+    unsigned int cy_start = job->y_start / cm->cell_h;
+    unsigned int cx_end = job->x_end / cm->cell_w + (job->x_end % cm->cell_w != 0);
+    unsigned int cy_end = job->y_end / cm->cell_h + (job->y_end % cm->cell_h != 0);
+    double cost = 0.0;
+
+    for (unsigned int cy = cy_start; cy < cy_end; cy++)
+    {
+        for (unsigned int cx = cx_start; cx < cx_end; cx++)
+        {
+            cost += cm->cost[cx + cy * cm->cells_x];
+        }
+    }
+
+    return cost;
+}
+
+
+unsigned int job_plan_bands_adaptive(render_job *jobs, unsigned int max_jobs, job_costmap *cm)
+{
+    double total = 0.0;
+    double acc = 0.0;
+    unsigned int n_bands = max_jobs < cm->dimy ? max_jobs : cm->dimy;
+    unsigned int job_n = 0;
+    unsigned int band_start = 0;
+
+    for (unsigned int y = 0; y < cm->dimy; y++)
+    {
+        total += cm->cost[y];
+    }
+
+    // Nothing has been measured yet
+    if (total <= 0.0)
+    {
+        return job_plan_bands(jobs, max_jobs, cm->dimx, cm->dimy);
+    }
+
+    for (unsigned int y = 0; y < cm->dimy; y++)
+    {
+        acc += cm->cost[y];
+
+        unsigned int rows_left = cm->dimy - (y + 1);
+        unsigned int bands_left = n_bands - (job_n + 1);
+
+        // Cut once this band reaches its share of the cost, or when every remaining
+        // row is needed to give the remaining bands a row each
+        if (y + 1 == cm->dimy || (bands_left > 0 &&
+            (acc >= total * (job_n + 1) / n_bands || rows_left == bands_left)))
+        {
+            jobs[job_n].x_start = 0;
+            jobs[job_n].x_end = cm->dimx;
+            jobs[job_n].y_start = band_start;
+            jobs[job_n].y_end = y + 1;
+            jobs[job_n].quit = 0;
+            jobs[job_n].in_arena = 1;
+            jobs[job_n].next = NULL;
+
+            band_start = y + 1;
+            job_n++;
+        }
+    }
+
+    return job_n;
+}
+
+
+typedef struct job_cost_entry {
+    double cost;
+    unsigned int idx;
+} job_cost_entry;
+
+
+static int cmp_job_cost(const void *a, const void *b)
+{
+    const job_cost_entry *ea = a;
+    const job_cost_entry *eb = b;
+
+    // Most expensive first, then by original position
+    if (ea->cost != eb->cost)
+    {
+        return ea->cost < eb->cost ? 1 : -1;
+    }
+
+    return (ea->idx > eb->idx) - (ea->idx < eb->idx);
+}
+
+
+int job_plan_sort_cost(render_job *jobs, unsigned int n, job_costmap *cm)
+{
+    job_cost_entry *entries;
+    render_job *sorted;
+
+    entries = malloc(sizeof(job_cost_entry) * n);
+    sorted = malloc(sizeof(render_job) * n);
+
+    if (entries == NULL || sorted == NULL)
+    {
+        free(entries);
+        free(sorted);
+        return -1;
+    }
+
+    for (unsigned int i = 0; i < n; i++)
+    {
+        entries[i].cost = costmap_job_cost(cm, jobs + i);
+        entries[i].idx = i;
+    }
+
+    qsort(entries, n, sizeof(job_cost_entry), cmp_job_cost);
+
+    for (unsigned int i = 0; i < n; i++)
+    {
+        sorted[i] = jobs[entries[i].idx];
+    }
+
+    for (unsigned int i = 0; i < n; i++)
+    {
+        jobs[i] = sorted[i];
+    }
+
+    free(entries);
+    free(sorted);
+
+    return 0;
 }
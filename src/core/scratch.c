@@ -0,0 +1,43 @@
+#include "core/scratch.h"
+
+// -----===[ Functions ]===-----
+
+scratch_arena *scratch_init(size_t size)
+{
+    scratch_arena *sa;
+
+    sa = malloc(sizeof(scratch_arena));
+
+    if (sa == NULL)
+    {
+        goto exit_fail;
+    }
+
+    // Round up, as aligned_alloc requires a multiple of the alignment
+    size = (size + SCRATCH_ALIGN - 1) & ~((size_t) SCRATCH_ALIGN - 1);
+
+    sa->base = aligned_alloc(SCRATCH_ALIGN, size ? size : SCRATCH_ALIGN);
+
+    if (sa->base == NULL)
+    {
+        goto sa_cleanup;
+    }
+
+    sa->size = size;
+    sa->used = 0;
+
+    return sa;
+
+sa_cleanup:
+    free(sa);
+
+exit_fail:
+    return NULL;
+}
+
+
+void scratch_delete(scratch_arena *sa)
+{
+    free(sa->base);
+    free(sa);
+}
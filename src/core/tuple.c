@@ -142,9 +142,9 @@ tup3 hadamard_t3(tup3 *a, tup3 *b)
     tup3 res;
 
     res.x = a->x * b->x;
-    res.y = a->y * b->x;
-    res.z = a->z * b->x;
-    res.w = a->w * b->x;
+    res.y = a->y * b->y;
+    res.z = a->z * b->z;
+    res.w = a->w * b->w;
 
     return res;
 }
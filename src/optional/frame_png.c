@@ -15,7 +15,7 @@ static inline uint8_t prop_to_255(float prop)
 }
 
 
-static inline float c255_to_prop(char c255)
+static inline float c255_to_prop(uint8_t c255)
 {
     return ((float) c255) / 255.0f;
 }
@@ -71,7 +71,11 @@ int frame_png_dump(char *path, framebuf *fb)
 
     // Create PNG rows
     png_rows = png_malloc(png_ptr, fb->dimy * sizeof(png_byte *));
-    tup3 curr_t3;
+
+    // Rows of other formats or layouts are converted (and de-tiled) into linear memory first
+    int direct = (fb->format == FB_FORMAT_TUP3 && fb->layout == FB_LAYOUT_LINEAR);
+    tup3 *linear_row = direct ? NULL : png_malloc(png_ptr, sizeof(tup3) * fb->dimx);
+
     for (unsigned int y = 0; y < fb->dimy; y++)
     {
         // * 3 is for rgb components (no alpha)
@@ -79,16 +83,27 @@ int frame_png_dump(char *path, framebuf *fb)
         unsigned int row_x = 0;
         png_rows[y] = png_row;
 
+        tup3 *row = direct ? fb->buf + (size_t) y * fb->dimx : linear_row;
+
+        if (!direct)
+        {
+            framebuf_read_row(fb, 0, fb->dimx, y, linear_row);
+        }
+
         for (unsigned int x = 0; x < fb->dimx; x++)
         {
-            framebuf_read(fb, x, y, &curr_t3);
-            rgb_pix p = t3_to_rgb(&curr_t3);
+            rgb_pix p = t3_to_rgb(row + x);
             png_row[row_x++] = p.r;
             png_row[row_x++] = p.g;
             png_row[row_x++] = p.b;
         }
     }
 
+    if (linear_row != NULL)
+    {
+        png_free(png_ptr, linear_row);
+    }
+
     // Write to the PNG
     png_init_io(png_ptr, png_f);
     png_set_rows(png_ptr, info_ptr, png_rows);
@@ -210,7 +225,7 @@ framebuf *frame_png_load(char *path)
                          c255_to_prop(row_pointers[y][x + 1]),
                          c255_to_prop(row_pointers[y][x + 2]),
                          0.0 };
-            framebuf_write(res, buf_x, y, &col);
+            framebuf_set(res, buf_x, y, &col);
             buf_x++;
         }
     }
@@ -55,6 +55,9 @@ void frag_init(int argc, char **argv)
     // Set up render frame buffer
     create_render_frame(res_x, res_y);
 
+    // Neither the render frame nor BACKBUF are used outside of rendering
+    swap_backbuf = 1;
+
     // Set up output
     set_frame_output(argv[1], "png", frame_png_dump);
 }
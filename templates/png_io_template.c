@@ -53,6 +53,9 @@ void frag_init(int argc, char **argv)
     // Remove the sampler
     framebuf_delete(sampler);
 
+    // Neither the render frame nor BACKBUF are used outside of rendering
+    swap_backbuf = 1;
+
     // Set up output
     set_frame_output(argv[2], "png", frame_png_dump);
 }
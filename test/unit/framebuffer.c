@@ -7,6 +7,12 @@
 #include "core/framebuffer.h"
 
 
+static float pixel_red(tup3 *px)
+{
+    return px->x;
+}
+
+
 static void framebuf_test_init(void **state)
 {
     (void) state;
@@ -41,10 +47,404 @@ static void framebuf_test_init(void **state)
 }
 
 
+static void framebuf_test_formats(void **state)
+{
+    (void) state;
+
+    fb_format formats[] = { FB_FORMAT_RGBA8, FB_FORMAT_RGBA16F, FB_FORMAT_RGB32F };
+    float tolerance[] = { 1.0f / 255.0f, 0.001f, TUP_EPSILON };
+    tup3 col = col_xyz(0.25f, 0.5f, 0.75f);
+
+    assert_int_equal(framebuf_px_size(FB_FORMAT_TUP3), 16);
+    assert_int_equal(framebuf_px_size(FB_FORMAT_RGBA8), 4);
+    assert_int_equal(framebuf_px_size(FB_FORMAT_RGBA16F), 8);
+    assert_int_equal(framebuf_px_size(FB_FORMAT_RGB32F), 12);
+
+    for (unsigned int f = 0; f < 3; f++)
+    {
+        framebuf *fb = framebuf_init_fmt(5, 3, formats[f]);
+        framebuf *full = framebuf_init(5, 3);
+        tup3 read;
+
+        assert_non_null(fb);
+        assert_non_null(full);
+        assert_null(fb->buf);
+
+        // Initialised to opaque black
+        read = framebuf_get(fb, 4, 2);
+        assert_float_equal(read.x, 0.0f, TUP_EPSILON);
+        assert_float_equal(read.w, 1.0f, TUP_EPSILON);
+
+        // Pixels are converted on the way in and out
+        assert_int_equal(framebuf_write(fb, 1, 2, &col), 0);
+        assert_int_equal(framebuf_read(fb, 1, 2, &read), 0);
+
+        assert_float_equal(read.x, col.x, tolerance[f]);
+        assert_float_equal(read.y, col.y, tolerance[f]);
+        assert_float_equal(read.z, col.z, tolerance[f]);
+        assert_float_equal(read.w, 1.0f, tolerance[f]);
+
+        // As are whole framebufs
+        assert_int_equal(framebuf_copy(full, fb), 0);
+        assert_float_equal(full->buf[1 + 2 * 5].z, col.z, tolerance[f]);
+
+        framebuf_set(full, 0, 0, &col);
+        assert_int_equal(framebuf_copy_rect(fb, full, 0, 1, 0, 1), 0);
+        assert_float_equal(framebuf_get(fb, 0, 0).y, col.y, tolerance[f]);
+
+        framebuf_delete(fb);
+        framebuf_delete(full);
+    }
+}
+
+
+static void framebuf_test_rgba8_clamp(void **state)
+{
+    (void) state;
+
+    tup3 over = tuple3(-0.5f, 1.5f, 0.5f, 1.0f);
+    tup3 row[3] = { over, over, over };
+    fb_rgba8 packed[3];
+
+    // Out of range channels are clamped, both singly and by rows
+    fb_rgba8 px = fb_pack_rgba8(&over);
+
+    assert_int_equal(px[0], 0);
+    assert_int_equal(px[1], 255);
+    assert_int_equal(px[2], 128);
+    assert_int_equal(px[3], 255);
+
+    framebuf_pack_row(FB_FORMAT_RGBA8, packed, row, 3);
+    framebuf_unpack_row(FB_FORMAT_RGBA8, row, packed, 3);
+
+    assert_float_equal(row[2].x, 0.0f, TUP_EPSILON);
+    assert_float_equal(row[2].y, 1.0f, TUP_EPSILON);
+}
+
+
+static void framebuf_test_layouts(void **state)
+{
+    (void) state;
+
+    fb_layout layouts[] = { FB_LAYOUT_TILED, FB_LAYOUT_MORTON };
+
+    // Not a whole number of tiles, so the edge tiles are padded
+    framebuf *linear = framebuf_init(21, 11);
+
+    assert_non_null(linear);
+
+    for (unsigned int y = 0; y < 11; y++)
+    {
+        for (unsigned int x = 0; x < 21; x++)
+        {
+            tup3 col = col_xyz((float) x, (float) y, 0.0f);
+
+            framebuf_set(linear, x, y, &col);
+        }
+    }
+
+    for (unsigned int l = 0; l < 2; l++)
+    {
+        framebuf *tiled = framebuf_init_layout(21, 11, FB_FORMAT_TUP3, layouts[l]);
+        framebuf *back = framebuf_init(21, 11);
+        tup3 row[21];
+
+        assert_non_null(tiled);
+        assert_non_null(back);
+        assert_int_equal(tiled->tiles_x, 3);
+
+        // Every pixel should have its own place in the buffer
+        unsigned char *used = calloc(3 * 2 * FB_TILE_DIM * FB_TILE_DIM, 1);
+
+        assert_non_null(used);
+
+        for (unsigned int y = 0; y < 11; y++)
+        {
+            for (unsigned int x = 0; x < 21; x++)
+            {
+                size_t i = framebuf_index(tiled, x, y);
+
+                assert_true(i < 3 * 2 * FB_TILE_DIM * FB_TILE_DIM);
+                assert_int_equal(used[i]++, 0);
+            }
+        }
+
+        free(used);
+
+        // Vertical neighbours within a tile share a tile
+        assert_true(framebuf_index(tiled, 3, 1) - framebuf_index(tiled, 3, 0) < FB_TILE_DIM * FB_TILE_DIM);
+
+        // Copying in and out of the layout keeps every pixel
+        assert_int_equal(framebuf_copy(tiled, linear), 0);
+
+        assert_float_equal(framebuf_get(tiled, 17, 9).x, 17.0f, TUP_EPSILON);
+        assert_float_equal(framebuf_sample_clamp(tiled, 30, 9).x, 20.0f, TUP_EPSILON);
+
+        assert_int_equal(framebuf_read_row(tiled, 3, 21, 10, row), 0);
+
+        for (unsigned int x = 3; x < 21; x++)
+        {
+            assert_float_equal(row[x - 3].x, (float) x, TUP_EPSILON);
+            assert_float_equal(row[x - 3].y, 10.0f, TUP_EPSILON);
+        }
+
+        assert_int_equal(framebuf_read_row(tiled, 0, 22, 0, row), -1);
+
+        assert_int_equal(framebuf_copy(back, tiled), 0);
+
+        for (unsigned int i = 0; i < 21 * 11; i++)
+        {
+            assert_true(eq_t3(back->buf + i, linear->buf + i));
+        }
+
+        framebuf_delete(tiled);
+        framebuf_delete(back);
+    }
+
+    framebuf_delete(linear);
+}
+
+
+static void framebuf_test_unchecked(void **state)
+{
+    (void) state;
+
+    framebuf *fb = framebuf_init(4, 3);
+    tup3 col = col_xyz(0.25f, 0.5f, 0.75f);
+    tup3 read;
+
+    assert_non_null(fb);
+
+    // Unchecked accesses should agree with the checked ones
+    framebuf_set(fb, 3, 2, &col);
+
+    assert_int_equal(framebuf_read(fb, 3, 2, &read), 0);
+    assert_true(eq_t3(&read, &col));
+
+    read = framebuf_get(fb, 3, 2);
+    assert_true(eq_t3(&read, &col));
+    assert_ptr_equal(framebuf_px(fb, 3, 2), fb->buf + 11);
+
+    assert_int_equal(framebuf_write(fb, 4, 0, &col), -1);
+    assert_int_equal(framebuf_read(fb, 0, 3, NULL), -1);
+
+    framebuf_delete(fb);
+}
+
+
+static void framebuf_test_sample(void **state)
+{
+    (void) state;
+
+    framebuf *fb = framebuf_init(4, 2);
+
+    assert_non_null(fb);
+
+    // Tag each pixel with its coordinates
+    for (unsigned int y = 0; y < 2; y++)
+    {
+        for (unsigned int x = 0; x < 4; x++)
+        {
+            tup3 col = col_xyz((float) x, (float) y, 0.0f);
+
+            framebuf_set(fb, x, y, &col);
+        }
+    }
+
+    // Expected x coordinates for x = -5 .. 8
+    unsigned int clamp[] = { 0, 0, 0, 0, 0, 0, 1, 2, 3, 3, 3, 3, 3, 3 };
+    unsigned int wrap[] = { 3, 0, 1, 2, 3, 0, 1, 2, 3, 0, 1, 2, 3, 0 };
+    unsigned int mirror[] = { 3, 3, 2, 1, 0, 0, 1, 2, 3, 3, 2, 1, 0, 0 };
+
+    for (int x = -5; x <= 8; x++)
+    {
+        assert_float_equal(framebuf_sample_clamp(fb, x, 0).x, (float) clamp[x + 5], TUP_EPSILON);
+        assert_float_equal(framebuf_sample_wrap(fb, x, 0).x, (float) wrap[x + 5], TUP_EPSILON);
+        assert_float_equal(framebuf_sample_mirror(fb, x, 0).x, (float) mirror[x + 5], TUP_EPSILON);
+        assert_float_equal(framebuf_sample(fb, x, 0, FB_ADDR_MIRROR).x, (float) mirror[x + 5], TUP_EPSILON);
+    }
+
+    // Rows are mapped independently
+    assert_float_equal(framebuf_sample_clamp(fb, 1, -3).y, 0.0f, TUP_EPSILON);
+    assert_float_equal(framebuf_sample_wrap(fb, 1, -3).y, 1.0f, TUP_EPSILON);
+    assert_float_equal(framebuf_sample_mirror(fb, 1, 2).y, 1.0f, TUP_EPSILON);
+
+    framebuf_delete(fb);
+}
+
+
+static void framebuf_test_gather(void **state)
+{
+    (void) state;
+
+    fb_address modes[] = { FB_ADDR_CLAMP, FB_ADDR_WRAP, FB_ADDR_MIRROR };
+    fb_layout layouts[] = { FB_LAYOUT_LINEAR, FB_LAYOUT_TILED };
+    tup3 dest[14 * 11];
+
+    for (unsigned int l = 0; l < 2; l++)
+    {
+        framebuf *fb = framebuf_init_layout(9, 6, FB_FORMAT_TUP3, layouts[l]);
+
+        assert_non_null(fb);
+
+        for (unsigned int y = 0; y < 6; y++)
+        {
+            for (unsigned int x = 0; x < 9; x++)
+            {
+                tup3 col = col_xyz((float) x, (float) y, 0.0f);
+
+                framebuf_set(fb, x, y, &col);
+            }
+        }
+
+        // Regions overlapping each edge, and containing the whole framebuf
+        for (unsigned int m = 0; m < 3; m++)
+        {
+            for (int y0 = -4; y0 <= 3; y0++)
+            {
+                for (int x0 = -4; x0 <= 6; x0++)
+                {
+                    framebuf_gather_rect(fb, x0, y0, 14, 11, modes[m], dest);
+
+                    for (int r = 0; r < 11; r++)
+                    {
+                        for (int c = 0; c < 14; c++)
+                        {
+                            tup3 expected = framebuf_sample(fb, x0 + c, y0 + r, modes[m]);
+
+                            assert_float_equal(dest[c + r * 14].x, expected.x, TUP_EPSILON);
+                            assert_float_equal(dest[c + r * 14].y, expected.y, TUP_EPSILON);
+                        }
+                    }
+
+                    framebuf_gather_col(fb, x0, y0, 11, modes[m], dest);
+
+                    for (int r = 0; r < 11; r++)
+                    {
+                        tup3 expected = framebuf_sample(fb, x0, y0 + r, modes[m]);
+
+                        assert_float_equal(dest[r].x, expected.x, TUP_EPSILON);
+                        assert_float_equal(dest[r].y, expected.y, TUP_EPSILON);
+                    }
+                }
+            }
+        }
+
+        framebuf_delete(fb);
+    }
+}
+
+
+static void framebuf_test_sort_rows(void **state)
+{
+    (void) state;
+
+    // Long enough rows to be radix sorted
+    framebuf *fb = framebuf_init(200, 3);
+
+    assert_non_null(fb);
+
+    for (unsigned int y = 0; y < 3; y++)
+    {
+        for (unsigned int x = 0; x < 200; x++)
+        {
+            float v = (float) ((x * 37 + y * 11) % 200) / 200.0f;
+            tup3 col = col_xyz(v, v, v);
+
+            framebuf_write(fb, x, y, &col);
+        }
+    }
+
+    assert_int_equal(framebuf_sort_segments(fb, SORT_AXIS_ROWS, 0, NULL), 0);
+
+    // Each row is now a single ascending run
+    for (unsigned int y = 0; y < 3; y++)
+    {
+        for (unsigned int x = 0; x < 200; x++)
+        {
+            tup3 col;
+
+            framebuf_read(fb, x, y, &col);
+            assert_float_equal(col.x, (float) x / 200.0f, TUP_EPSILON);
+        }
+    }
+
+    framebuf_delete(fb);
+}
+
+
+static void framebuf_test_sort_segments(void **state)
+{
+    (void) state;
+
+    framebuf *fb = framebuf_init(2, 10);
+
+    assert_non_null(fb);
+
+    // Descending columns, with the second column tagged to check that columns stay separate
+    for (unsigned int y = 0; y < 10; y++)
+    {
+        for (unsigned int x = 0; x < 2; x++)
+        {
+            tup3 col = col_xyz((9 - y) / 10.0f, 0.0f, (float) x);
+
+            framebuf_write(fb, x, y, &col);
+        }
+    }
+
+    // Segments of 4, 4 and 2 pixels, sorted by the red channel
+    assert_int_equal(framebuf_sort_segments(fb, SORT_AXIS_COLUMNS, 4, pixel_red), 0);
+
+    float expect[10] = { 0.6f, 0.7f, 0.8f, 0.9f, 0.2f, 0.3f, 0.4f, 0.5f, 0.0f, 0.1f };
+
+    for (unsigned int y = 0; y < 10; y++)
+    {
+        for (unsigned int x = 0; x < 2; x++)
+        {
+            tup3 col;
+
+            framebuf_read(fb, x, y, &col);
+            assert_float_equal(col.x, expect[y], TUP_EPSILON);
+            assert_float_equal(col.z, (float) x, TUP_EPSILON);
+        }
+    }
+
+    framebuf_delete(fb);
+}
+
+
+static void framebuf_test_sort_keys(void **state)
+{
+    (void) state;
+
+    tup3 red = col_xyz(1.0f, 0.0f, 0.0f);
+    tup3 green = col_xyz(0.0f, 1.0f, 0.0f);
+    tup3 blue = col_xyz(0.0f, 0.0f, 1.0f);
+    tup3 grey = col_xyz(0.5f, 0.5f, 0.5f);
+
+    assert_float_equal(pixel_hue(&red), 0.0f, TUP_EPSILON);
+    assert_float_equal(pixel_hue(&green), 1.0f / 3.0f, TUP_EPSILON);
+    assert_float_equal(pixel_hue(&blue), 2.0f / 3.0f, TUP_EPSILON);
+    assert_float_equal(pixel_hue(&grey), 0.0f, TUP_EPSILON);
+
+    assert_float_equal(pixel_luminance(&grey), 0.5f, TUP_EPSILON);
+    assert_true(pixel_luminance(&green) > pixel_luminance(&red));
+}
+
+
 int main(void)
 {
     const struct CMUnitTest tests[] = {
         cmocka_unit_test(framebuf_test_init),
+        cmocka_unit_test(framebuf_test_formats),
+        cmocka_unit_test(framebuf_test_rgba8_clamp),
+        cmocka_unit_test(framebuf_test_layouts),
+        cmocka_unit_test(framebuf_test_unchecked),
+        cmocka_unit_test(framebuf_test_sample),
+        cmocka_unit_test(framebuf_test_gather),
+        cmocka_unit_test(framebuf_test_sort_rows),
+        cmocka_unit_test(framebuf_test_sort_segments),
+        cmocka_unit_test(framebuf_test_sort_keys),
     };
 
     return cmocka_run_group_tests(tests, NULL, NULL);
@@ -0,0 +1,616 @@
+#include <stdarg.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <setjmp.h>
+#include <cmocka.h>
+
+#include "core/render_job.h"
+#include "core/frame_io.h"
+
+
+/*
+ * Checks that a set of jobs covers every pixel of a frame exactly once
+ */
+static void check_coverage(render_job *jobs, unsigned int n, unsigned int dimx, unsigned int dimy)
+{
+    unsigned char *covered = calloc(dimx * dimy, 1);
+
+    assert_non_null(covered);
+
+    for (unsigned int i = 0; i < n; i++)
+    {
+        assert_true(jobs[i].x_start < jobs[i].x_end);
+        assert_true(jobs[i].y_start < jobs[i].y_end);
+        assert_true(jobs[i].x_end <= dimx);
+        assert_true(jobs[i].y_end <= dimy);
+        assert_int_equal(jobs[i].quit, 0);
+
+        for (unsigned int y = jobs[i].y_start; y < jobs[i].y_end; y++)
+        {
+            for (unsigned int x = jobs[i].x_start; x < jobs[i].x_end; x++)
+            {
+                covered[x + y * dimx]++;
+            }
+        }
+    }
+
+    for (unsigned int p = 0; p < dimx * dimy; p++)
+    {
+        assert_int_equal(covered[p], 1);
+    }
+
+    free(covered);
+}
+
+
+static void job_plan_check_bands(void **state)
+{
+    (void) state;
+
+    render_job jobs[8];
+    unsigned int n;
+
+    n = job_plan_bands(jobs, 8, 37, 21);
+
+    assert_in_range(n, 1, 8);
+    check_coverage(jobs, n, 37, 21);
+
+    // Fewer rows than jobs
+    n = job_plan_bands(jobs, 8, 5, 3);
+
+    assert_int_equal(n, 3);
+    check_coverage(jobs, n, 5, 3);
+}
+
+
+static void job_plan_check_group_bands(void **state)
+{
+    (void) state;
+
+    render_job jobs[8];
+    unsigned int n;
+
+    // Band boundaries should fall between groups of 7 rows
+    n = job_plan_group_bands(jobs, 4, 10, 50, 7);
+
+    assert_int_equal(n, 4);
+    check_coverage(jobs, n, 10, 50);
+
+    for (unsigned int i = 0; i < n; i++)
+    {
+        assert_int_equal(jobs[i].y_start % 7, 0);
+    }
+
+    // Fewer groups than jobs
+    n = job_plan_group_bands(jobs, 8, 10, 20, 8);
+
+    assert_int_equal(n, 3);
+    check_coverage(jobs, n, 10, 20);
+}
+
+
+static void job_plan_check_tiles(void **state)
+{
+    (void) state;
+
+    tile_order orders[] = { TILE_ORDER_ROW, TILE_ORDER_MORTON, TILE_ORDER_HILBERT };
+    unsigned int count = job_plan_tile_count(100, 45, 16, 8);
+
+    assert_int_equal(count, 7 * 6);
+
+    render_job *jobs = malloc(sizeof(render_job) * count);
+
+    assert_non_null(jobs);
+
+    for (unsigned int o = 0; o < 3; o++)
+    {
+        unsigned int n = job_plan_tiles(jobs, 100, 45, 16, 8, orders[o]);
+
+        assert_int_equal(n, count);
+        check_coverage(jobs, n, 100, 45);
+    }
+
+    free(jobs);
+}
+
+
+static void job_plan_check_hilbert_adjacent(void **state)
+{
+    (void) state;
+
+    render_job jobs[64];
+    unsigned int n;
+
+    // On a power of two grid, consecutive tiles along a Hilbert curve always share an edge
+    n = job_plan_tiles(jobs, 64, 64, 8, 8, TILE_ORDER_HILBERT);
+
+    assert_int_equal(n, 64);
+
+    for (unsigned int i = 1; i < n; i++)
+    {
+        int dx = (int) jobs[i].x_start - (int) jobs[i - 1].x_start;
+        int dy = (int) jobs[i].y_start - (int) jobs[i - 1].y_start;
+
+        assert_int_equal(abs(dx) + abs(dy), 8);
+    }
+}
+
+
+static void job_plan_check_adaptive(void **state)
+{
+    (void) state;
+
+    render_job jobs[4];
+    unsigned int n;
+    job_costmap *cm = costmap_init(10, 16, 10, 1);
+
+    assert_non_null(cm);
+
+    // Nothing measured yet - equal sized bands
+    n = job_plan_bands_adaptive(jobs, 4, cm);
+
+    assert_int_equal(n, 4);
+    check_coverage(jobs, n, 10, 16);
+    assert_int_equal(jobs[0].y_end, 4);
+
+    // Make the bottom quarter of the frame as expensive as the rest combined
+    render_job cheap = { .x_start = 0, .x_end = 10, .y_start = 0, .y_end = 12 };
+    render_job expensive = { .x_start = 0, .x_end = 10, .y_start = 12, .y_end = 16 };
+
+    costmap_record(cm, &cheap, 1200);
+    costmap_record(cm, &expensive, 1200);
+
+    assert_float_equal(costmap_job_cost(cm, &cheap), 1200.0, 0.01);
+
+    n = job_plan_bands_adaptive(jobs, 4, cm);
+
+    assert_int_equal(n, 4);
+    check_coverage(jobs, n, 10, 16);
+    assert_int_equal(jobs[0].y_end, 6);
+    assert_int_equal(jobs[1].y_end, 12);
+    assert_int_equal(jobs[2].y_end, 14);
+
+    // Equal sized bands should be issued most expensive first, otherwise in order
+    n = job_plan_bands(jobs, 4, 10, 16);
+
+    assert_int_equal(job_plan_sort_cost(jobs, n, cm), 0);
+
+    assert_int_equal(jobs[0].y_start, 12);
+    assert_int_equal(jobs[1].y_start, 0);
+    assert_int_equal(jobs[2].y_start, 4);
+    assert_int_equal(jobs[3].y_start, 8);
+
+    costmap_delete(cm);
+}
+
+
+/*
+ * Claims the next ready job of a wavefront, checking which job and frame it is
+ */
+static void check_claim(job_wavefront *jw, unsigned int job, unsigned long frame)
+{
+    unsigned long claimed_frame;
+    render_job *claimed = jobw_claim(jw, &claimed_frame);
+
+    assert_ptr_equal(claimed, jw->jobs + job);
+    assert_int_equal(claimed_frame, frame);
+}
+
+
+static void job_plan_check_wavefront(void **state)
+{
+    (void) state;
+
+    job_wavefront *jw = jobw_init(3);
+
+    assert_non_null(jw);
+
+    // A row of three tiles, each of which reads a pixel into its neighbours
+    jw->n_jobs = job_plan_tiles(jw->jobs, 48, 16, 16, 16, TILE_ORDER_ROW);
+
+    assert_int_equal(jw->n_jobs, 3);
+    assert_int_equal(jobw_link(jw, 1), 0);
+
+    jobw_start(jw, 3);
+
+    check_claim(jw, 0, 0);
+    check_claim(jw, 1, 0);
+    check_claim(jw, 2, 0);
+
+    // The outer tiles of the next frame also wait on the middle tile
+    jobw_report_complete(jw, jw->jobs + 0, 0);
+    jobw_report_complete(jw, jw->jobs + 2, 0);
+
+    assert_int_equal(jw->ready_count, 0);
+
+    jobw_report_complete(jw, jw->jobs + 1, 0);
+
+    assert_int_equal(jw->ready_count, 3);
+
+    jobw_wait_frame(jw, 0);
+
+    for (unsigned int i = 0; i < 3; i++)
+    {
+        unsigned long frame;
+        render_job *job = jobw_claim(jw, &frame);
+
+        assert_non_null(job);
+        assert_int_equal(frame, 1);
+
+        jobw_report_complete(jw, job, 1);
+    }
+
+    // The last frame reuses the framebuffer of the first, so waits for it to be released
+    assert_int_equal(jw->ready_count, 0);
+
+    jobw_wait_frame(jw, 1);
+    jobw_release_frame(jw, 0);
+
+    assert_int_equal(jw->ready_count, 3);
+
+    jobw_quit(jw);
+    jobw_delete(jw);
+}
+
+
+static void job_plan_check_dispenser(void **state)
+{
+    (void) state;
+
+    job_dispenser *jd = jobd_init(10);
+
+    assert_non_null(jd);
+    assert_int_equal(job_plan_bands(jd->jobs, 10, 64, 40), 10);
+
+    for (int frame = 0; frame < 2; frame++)
+    {
+        jobd_start_frame(jd);
+
+        // Jobs are claimed in order, and claiming stops once every job has been claimed
+        for (unsigned int i = 0; i < 10; i++)
+        {
+            assert_ptr_equal(jobd_claim(jd), jd->jobs + i);
+        }
+
+        for (int i = 0; i < 3; i++)
+        {
+            assert_null(jobd_claim(jd));
+        }
+    }
+
+    jobd_quit(jd);
+    jobd_delete(jd);
+}
+
+
+static void job_plan_check_stealing(void **state)
+{
+    (void) state;
+
+    unsigned int claims[37];
+    unsigned int seeds[4] = {1, 2, 3, 4};
+    job_dispenser *jd = jobd_init(37);
+    render_job *job;
+
+    assert_non_null(jd);
+    assert_int_equal(job_plan_bands(jd->jobs, 37, 64, 37 * 2), 37);
+    assert_int_equal(jobd_enable_stealing(jd, 4), 0);
+
+    // Workers drain in turn at different rates, so that most of the jobs of the later workers are stolen
+    for (unsigned int rate = 1; rate <= 4; rate++)
+    {
+        unsigned int n_claimed = 0;
+        int any_claimed = 1;
+
+        memset(claims, 0, sizeof(claims));
+        jobd_start_frame(jd);
+
+        while (any_claimed)
+        {
+            any_claimed = 0;
+
+            for (unsigned int w = 0; w < 4; w++)
+            {
+                for (unsigned int i = 0; i < (w == 0 ? rate : 1); i++)
+                {
+                    job = jobd_claim_local(jd, w, seeds + w);
+
+                    if (job != NULL)
+                    {
+                        assert_in_range(job - jd->jobs, 0, 36);
+
+                        claims[job - jd->jobs]++;
+                        n_claimed++;
+                        any_claimed = 1;
+                    }
+                }
+            }
+        }
+
+        assert_int_equal(n_claimed, 37);
+
+        for (unsigned int i = 0; i < 37; i++)
+        {
+            assert_int_equal(claims[i], 1);
+        }
+
+        for (unsigned int w = 0; w < 4; w++)
+        {
+            assert_null(jobd_claim_local(jd, w, seeds + w));
+        }
+    }
+
+    jobd_quit(jd);
+    jobd_delete(jd);
+}
+
+
+#define STEAL_WORKERS (4)
+#define STEAL_JOBS (61)
+#define STEAL_FRAMES (200)
+
+typedef struct steal_args {
+    job_dispenser *jd;
+    unsigned int worker;
+    atomic_uint *claims;
+} steal_args;
+
+/*
+ * Claims jobs of the current frame on a separate thread, until there are none left
+ */
+static void *steal_main(void *args)
+{
+    steal_args *sa = (steal_args *) args;
+    unsigned int seed = sa->worker + 1;
+    render_job *job;
+
+    while ((job = jobd_claim_local(sa->jd, sa->worker, &seed)) != NULL)
+    {
+        atomic_fetch_add(sa->claims + (job - sa->jd->jobs), 1);
+    }
+
+    return NULL;
+}
+
+
+static void job_plan_check_stealing_threaded(void **state)
+{
+    (void) state;
+
+    atomic_uint claims[STEAL_JOBS];
+    pthread_t threads[STEAL_WORKERS];
+    steal_args args[STEAL_WORKERS];
+    job_dispenser *jd = jobd_init(STEAL_JOBS);
+
+    assert_non_null(jd);
+    assert_int_equal(job_plan_bands(jd->jobs, STEAL_JOBS, 64, STEAL_JOBS), STEAL_JOBS);
+    assert_int_equal(jobd_enable_stealing(jd, STEAL_WORKERS), 0);
+
+    // Owners and thieves race over the same deques, but every job must still be claimed exactly once
+    for (int frame = 0; frame < STEAL_FRAMES; frame++)
+    {
+        for (unsigned int i = 0; i < STEAL_JOBS; i++)
+        {
+            atomic_init(claims + i, 0);
+        }
+
+        jobd_start_frame(jd);
+
+        for (unsigned int w = 0; w < STEAL_WORKERS; w++)
+        {
+            args[w] = (steal_args) {jd, w, claims};
+
+            assert_int_equal(pthread_create(threads + w, NULL, steal_main, args + w), 0);
+        }
+
+        for (unsigned int w = 0; w < STEAL_WORKERS; w++)
+        {
+            pthread_join(threads[w], NULL);
+        }
+
+        for (unsigned int i = 0; i < STEAL_JOBS; i++)
+        {
+            assert_int_equal(atomic_load(claims + i), 1);
+        }
+    }
+
+    jobd_quit(jd);
+    jobd_delete(jd);
+}
+
+
+#define BARRIER_THREADS (4)
+#define BARRIER_ROUNDS (500)
+
+typedef struct barrier_args {
+    frame_barrier *fb;
+    unsigned int n_threads;
+    atomic_uint *arrived;
+    atomic_uint *last;
+    atomic_uint *errors;
+} barrier_args;
+
+/*
+ * Passes the barrier repeatedly, checking that no thread passes before every thread has arrived
+ */
+static void *barrier_main(void *args)
+{
+    barrier_args *ba = (barrier_args *) args;
+    unsigned int n = ba->n_threads;
+
+    for (unsigned int round = 0; round < BARRIER_ROUNDS; round++)
+    {
+        atomic_fetch_add(ba->arrived, 1);
+
+        if (fbar_wait(ba->fb))
+        {
+            atomic_fetch_add(ba->last, 1);
+        }
+
+        // Others may already have arrived for the next round, but cannot have passed it
+        unsigned int arrived = atomic_load(ba->arrived);
+
+        if (arrived < n * (round + 1) || arrived >= n * (round + 2))
+        {
+            atomic_fetch_add(ba->errors, 1);
+        }
+    }
+
+    return NULL;
+}
+
+
+static void job_plan_check_barrier(void **state)
+{
+    (void) state;
+
+    pthread_t threads[BARRIER_THREADS];
+    barrier_args args;
+    atomic_uint arrived, last, errors;
+    frame_barrier *fb = fbar_init(BARRIER_THREADS);
+
+    assert_non_null(fb);
+
+    // Then again with fewer threads once resized
+    for (unsigned int n = BARRIER_THREADS; n >= 2; n -= 2)
+    {
+        atomic_init(&arrived, 0);
+        atomic_init(&last, 0);
+        atomic_init(&errors, 0);
+
+        fbar_resize(fb, n);
+        args = (barrier_args) {fb, n, &arrived, &last, &errors};
+
+        for (unsigned int i = 0; i < n; i++)
+        {
+            assert_int_equal(pthread_create(threads + i, NULL, barrier_main, &args), 0);
+        }
+
+        for (unsigned int i = 0; i < n; i++)
+        {
+            pthread_join(threads[i], NULL);
+        }
+
+        assert_int_equal(atomic_load(&errors), 0);
+        assert_int_equal(atomic_load(&arrived), n * BARRIER_ROUNDS);
+
+        // Exactly one thread is told it arrived last each round
+        assert_int_equal(atomic_load(&last), BARRIER_ROUNDS);
+    }
+
+    fbar_delete(fb);
+}
+
+
+#define WRITER_FRAMES (64)
+
+static pthread_mutex_t saved_lock = PTHREAD_MUTEX_INITIALIZER;
+static unsigned int saved[WRITER_FRAMES];
+static unsigned int saved_order[WRITER_FRAMES];
+static unsigned int n_saved;
+
+/*
+ * Records each saved frame by the number rendered into it, in place of writing an image
+ */
+static int record_frame(char *path, framebuf *fb)
+{
+    (void) path;
+
+    tup3 pixel;
+
+    framebuf_read(fb, 3, 3, &pixel);
+
+    pthread_mutex_lock(&saved_lock);
+
+    saved[(unsigned int) pixel.x]++;
+    saved_order[n_saved++] = (unsigned int) pixel.x;
+
+    pthread_mutex_unlock(&saved_lock);
+
+    return 0;
+}
+
+
+static void job_plan_check_writer(void **state)
+{
+    (void) state;
+
+    frame_writer *fw;
+    framebuf *render, *in_use;
+
+    set_frame_output("fwriter_unit", NULL, record_frame);
+
+    for (unsigned int depth = 1; depth <= 2; depth++)
+    {
+        for (unsigned int n_writers = 1; n_writers <= 2; n_writers++)
+        {
+            memset(saved, 0, sizeof(saved));
+            n_saved = 0;
+
+            fw = fwriter_init(depth, n_writers, 4, 4);
+            render = framebuf_init(4, 4);
+
+            assert_non_null(fw);
+            assert_non_null(render);
+
+            for (unsigned int f = 0; f < WRITER_FRAMES; f++)
+            {
+                tup3 frame_id = col_xyz((float) f, 0.0f, 0.0f);
+
+                for (unsigned int y = 0; y < 4; y++)
+                {
+                    for (unsigned int x = 0; x < 4; x++)
+                    {
+                        framebuf_write(render, x, y, &frame_id);
+                    }
+                }
+
+                // The submitted frame is still read from (as BACKBUF) while the next is rendered
+                fwriter_submit(fw, render, f);
+                in_use = render;
+                render = fwriter_acquire(fw, in_use);
+
+                assert_non_null(render);
+                assert_true(render != in_use);
+            }
+
+            framebuf_delete(render);
+            fwriter_delete(fw);
+
+            // Every frame is saved exactly once (and in order, with a single writer)
+            assert_int_equal(n_saved, WRITER_FRAMES);
+
+            for (unsigned int f = 0; f < WRITER_FRAMES; f++)
+            {
+                assert_int_equal(saved[f], 1);
+
+                if (n_writers == 1)
+                {
+                    assert_int_equal(saved_order[f], f);
+                }
+            }
+        }
+    }
+
+    free_frame_output();
+}
+
+
+int main(void)
+{
+    const struct CMUnitTest tests[] = {
+        cmocka_unit_test(job_plan_check_bands),
+        cmocka_unit_test(job_plan_check_group_bands),
+        cmocka_unit_test(job_plan_check_tiles),
+        cmocka_unit_test(job_plan_check_hilbert_adjacent),
+        cmocka_unit_test(job_plan_check_adaptive),
+        cmocka_unit_test(job_plan_check_wavefront),
+        cmocka_unit_test(job_plan_check_dispenser),
+        cmocka_unit_test(job_plan_check_stealing),
+        cmocka_unit_test(job_plan_check_stealing_threaded),
+        cmocka_unit_test(job_plan_check_barrier),
+        cmocka_unit_test(job_plan_check_writer),
+    };
+
+    return cmocka_run_group_tests(tests, NULL, NULL);
+}
@@ -0,0 +1,76 @@
+#include <stdarg.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <setjmp.h>
+#include <cmocka.h>
+
+#include "core/scratch.h"
+
+
+static void scratch_check_alloc(void **state)
+{
+    (void) state;
+
+    scratch_arena *sa = scratch_init(100);
+
+    assert_non_null(sa);
+
+    // Allocations are aligned, and do not overlap
+    char *a = scratch_alloc(sa, 3);
+    char *b = scratch_alloc(sa, 20);
+
+    assert_non_null(a);
+    assert_non_null(b);
+    assert_int_equal((uintptr_t) a % SCRATCH_ALIGN, 0);
+    assert_int_equal((uintptr_t) b % SCRATCH_ALIGN, 0);
+    assert_true(b >= a + 3);
+
+    // The arena is rounded up to 112 bytes, of which 48 are used
+    assert_non_null(scratch_alloc(sa, 64));
+    assert_null(scratch_alloc(sa, 1));
+
+    // Resetting reclaims everything
+    scratch_reset(sa);
+
+    assert_ptr_equal(scratch_alloc(sa, 112), a);
+    assert_null(scratch_alloc(sa, SIZE_MAX));
+
+    scratch_delete(sa);
+}
+
+
+static void scratch_check_mark(void **state)
+{
+    (void) state;
+
+    scratch_arena *sa = scratch_init(256);
+
+    assert_non_null(sa);
+
+    char *kept = scratch_alloc(sa, 32);
+    size_t mark = scratch_mark(sa);
+    char *temp = scratch_alloc(sa, 64);
+
+    // Releasing to a mark only reclaims what came after it
+    scratch_release(sa, mark);
+
+    assert_ptr_equal(scratch_alloc(sa, 16), temp);
+    assert_true(temp >= kept + 32);
+
+    // A missing arena never hands out memory
+    assert_null(scratch_alloc(NULL, 16));
+    assert_int_equal(scratch_mark(NULL), 0);
+
+    scratch_delete(sa);
+}
+
+
+int main(void)
+{
+    const struct CMUnitTest tests[] = {
+        cmocka_unit_test(scratch_check_alloc),
+        cmocka_unit_test(scratch_check_mark),
+    };
+
+    return cmocka_run_group_tests(tests, NULL, NULL);
+}
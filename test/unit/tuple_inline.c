@@ -0,0 +1,83 @@
+#include <stdarg.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <setjmp.h>
+#include <cmocka.h>
+
+#include "core/tuple_inline.h"
+
+
+static void tuple_inline_check_matches(void **state)
+{
+    (void) state;
+
+    tup3 a, b, res, expect;
+
+    a = tuple3v(3.0f, -2.0f, 5.0f, 1.0f);
+    b = tuple3v(-2.0f, 3.0f, 1.0f, 0.0f);
+
+    // Each inline function should match its out-of-line equivalent
+    res = add_t3v(a, b);
+    expect = add_t3(&a, &b);
+    assert_true(eq_t3v(res, expect));
+
+    res = sub_t3v(a, b);
+    expect = sub_t3(&a, &b);
+    assert_true(eq_t3v(res, expect));
+
+    res = mul_t3v(a, 2.5f);
+    expect = mul_t3(&a, 2.5f);
+    assert_true(eq_t3v(res, expect));
+
+    res = hadamard_t3v(a, b);
+    expect = hadamard_t3(&a, &b);
+    assert_true(eq_t3v(res, expect));
+    assert_float_equal(res.y, -6.0f, TUP_EPSILON);
+
+    res = norm_t3v(a);
+    expect = norm_t3(&a);
+    assert_true(eq_t3v(res, expect));
+
+    res = cross_t3v(a, b);
+    expect = cross_t3(&a, &b);
+    assert_true(eq_t3v(res, expect));
+
+    assert_float_equal(dot_t3v(a, b), dot_t3(&a, &b), TUP_EPSILON);
+    assert_float_equal(mag_t3v(a), mag_t3(&a), TUP_EPSILON);
+}
+
+
+static void tuple_inline_check_zero(void **state)
+{
+    (void) state;
+
+    tup3 a = vec3v(1.0f, 2.0f, 3.0f);
+
+    assert_true(eq_t3v(div_t3v(a, 0.0f), vec3_zero));
+    assert_true(eq_t3v(norm_t3v(vec3_zero), vec3_zero));
+    assert_false(eq_t3v(a, vec3_zero));
+}
+
+
+static void tuple_inline_check_alignment(void **state)
+{
+    (void) state;
+
+    tup3 tuples[3];
+
+    assert_int_equal(_Alignof(tup3), 16);
+    assert_int_equal(sizeof(tup3), 16);
+    assert_int_equal((uintptr_t) (tuples + 1) % 16, 0);
+}
+
+
+int main(void)
+{
+    const struct CMUnitTest tests[] = {
+        cmocka_unit_test(tuple_inline_check_matches),
+        cmocka_unit_test(tuple_inline_check_zero),
+        cmocka_unit_test(tuple_inline_check_alignment),
+    };
+
+    return cmocka_run_group_tests(tests, NULL, NULL);
+}
@@ -0,0 +1,124 @@
+#include <stdarg.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <setjmp.h>
+#include <cmocka.h>
+
+#include "core/tuple_x8.h"
+
+
+static void tuple_x8_check_lanes(void **state)
+{
+    (void) state;
+
+    tup3 tuples[TUP_LANES];
+
+    for (unsigned int i = 0; i < TUP_LANES; i++)
+    {
+        tuples[i] = tuple3(i, -2.0f * i, 0.5f, 1.0f);
+    }
+
+    tup3x8 a = load_t3x8(tuples, TUP_LANES);
+    tup3 b = tuple3(1.0f, 2.0f, 3.0f, 0.0f);
+    tup3x8 bx8 = splat_t3x8(&b);
+
+    tup3x8 res = add_t3x8(&a, &bx8);
+
+    // Each lane should match the scalar operation
+    for (unsigned int i = 0; i < TUP_LANES; i++)
+    {
+        tup3 expect = add_t3(tuples + i, &b);
+
+        assert_float_equal(res.x[i], expect.x, TUP_EPSILON);
+        assert_float_equal(res.y[i], expect.y, TUP_EPSILON);
+        assert_float_equal(res.z[i], expect.z, TUP_EPSILON);
+        assert_float_equal(res.w[i], expect.w, TUP_EPSILON);
+
+        tup3 cross = cross_t3(tuples + i, &b);
+        tup3x8 cross_x8 = cross_t3x8(&a, &bx8);
+
+        assert_float_equal(cross_x8.x[i], cross.x, TUP_EPSILON);
+        assert_float_equal(cross_x8.y[i], cross.y, TUP_EPSILON);
+        assert_float_equal(cross_x8.z[i], cross.z, TUP_EPSILON);
+
+        assert_float_equal(dot_t3x8(&a, &bx8)[i], dot_t3(tuples + i, &b), TUP_EPSILON);
+    }
+
+    assert_int_equal(eq_t3x8(&a, &a)[TUP_LANES - 1], -1);
+    assert_int_equal(eq_t3x8(&a, &bx8)[TUP_LANES - 1], 0);
+}
+
+
+static void tuple_x8_check_zero_lanes(void **state)
+{
+    (void) state;
+
+    tup3x8 a = vec3x8(splat_x8(3.0f), splat_x8(0.0f), splat_x8(4.0f));
+    f32x8 s = { 2.0f, 0.0f, 2.0f, 0.0f, 2.0f, 0.0f, 2.0f, 0.0f };
+
+    // Division by zero clears only that lane
+    tup3x8 res = div_t3x8(&a, s);
+
+    assert_float_equal(res.x[0], 1.5f, TUP_EPSILON);
+    assert_float_equal(res.z[0], 2.0f, TUP_EPSILON);
+    assert_float_equal(res.x[1], 0.0f, TUP_EPSILON);
+    assert_float_equal(res.z[1], 0.0f, TUP_EPSILON);
+
+    // As does normalising a zero vector
+    a.x[3] = 0.0f;
+    a.z[3] = 0.0f;
+
+    res = norm_t3x8(&a);
+
+    assert_float_equal(mag_t3x8(&a)[0], 5.0f, TUP_EPSILON);
+    assert_float_equal(res.x[0], 0.6f, TUP_EPSILON);
+    assert_float_equal(res.z[0], 0.8f, TUP_EPSILON);
+    assert_float_equal(res.x[3], 0.0f, TUP_EPSILON);
+    assert_float_equal(res.z[3], 0.0f, TUP_EPSILON);
+}
+
+
+static void tuple_x8_check_tail(void **state)
+{
+    (void) state;
+
+    tup3 src[3] = {
+        tuple3(1.0f, 2.0f, 3.0f, 4.0f),
+        tuple3(5.0f, 6.0f, 7.0f, 8.0f),
+        tuple3(9.0f, 10.0f, 11.0f, 12.0f)
+    };
+    tup3 dest[4] = { vec3_zero, vec3_zero, vec3_zero, vec3_zero };
+
+    // Lanes past the tail repeat the last tuple
+    tup3x8 a = load_t3x8(src, 3);
+
+    assert_float_equal(a.x[2], 9.0f, TUP_EPSILON);
+    assert_float_equal(a.x[TUP_LANES - 1], 9.0f, TUP_EPSILON);
+
+    // Only the first lanes are stored
+    store_t3x8(dest, &a, 3);
+
+    assert_true(eq_t3(dest + 1, src + 1));
+    assert_true(eq_t3(dest + 2, src + 2));
+    assert_true(eq_t3(dest + 3, &vec3_zero));
+
+    // Masks select the first lanes
+    mask8 m = mask_first_x8(3);
+    tup3x8 zero = splat_t3x8(&vec3_zero);
+    tup3x8 sel = select_t3x8(m, &a, &zero);
+
+    assert_float_equal(sel.y[2], 10.0f, TUP_EPSILON);
+    assert_float_equal(sel.y[3], 0.0f, TUP_EPSILON);
+}
+
+
+int main(void)
+{
+    const struct CMUnitTest tests[] = {
+        cmocka_unit_test(tuple_x8_check_lanes),
+        cmocka_unit_test(tuple_x8_check_zero_lanes),
+        cmocka_unit_test(tuple_x8_check_tail),
+    };
+
+    return cmocka_run_group_tests(tests, NULL, NULL);
+}